@@ -112,6 +112,9 @@ QtObject {
     property color tim_moveBoxColor: mp_orange_fade
     property color tim_ledBoxColor: mp_blue_fade
     property color tim_beatMarks: mp_black
+    property color tim_barShading: "#0A000000"
+    property color tim_waveform: "#40000000"
+    property color tim_waveformRms: "#60000000"
     property color tim_timeIndicator: "red"
     property color tim_ghostColorValid: "#8840DF40"
     property color tim_ghostColorInvalid: "#88DF4040"
@@ -341,6 +344,11 @@ QtObject {
     // target average beat spacing, as ratio of window width
     property real beatSpacing: 0.013
 
+    // zoom limits and zoom factor per wheel step
+    property real minZoom: 0.25
+    property real maxZoom: 8.0
+    property real zoomStep: 1.2
+
     // beat indicator
     property real beatIndicatorFontSize: 16.0 / 80.0 // ratio of timerbar height
     property real beatIndicatorPadding: 4.0 / 80.0 // ratio of timerbar height
@@ -26,12 +26,11 @@ import "../GuiStyle"
 Item {
   id: root
   property alias sliderPosition: songPositionSlider.visualPosition
+  property alias sliderPressed: songPositionSlider.pressed
   height: songPositionSlider.height + playControlItem.height
           + appWindow.guiMargin
 
   property int sliderHeight: width * Style.audioControl.sliderHeight
-  property bool robotSoundNeedsUpdate: false
-  property bool startPlayAfterRobotSoundUpdate: false
   property real songPositionMS: 0.0
 
   enabled: false
@@ -41,6 +40,8 @@ Item {
     onDoneLoading:{
       if(result){
         enabled = true
+        // the position slider follows the notifications, while the playhead
+        // reads the audio clock every frame, see PlayheadItem
         backend.audioPlayer.setNotifyInterval(30);
         songPositionMS = 0.0
         songPositionSlider.to =
@@ -61,24 +62,8 @@ Item {
   }
 
   function togglePlay(){
-    // check if robot sound needs to be recompiled:
-    if(!backend.audioPlayer.isPlaying)
-    {
-      if(robotHumanButtons.runRobotSound && root.robotSoundNeedsUpdate)
-      {
-        fileProcess.open()
-        backend.setPlayBackForRobots()
-        root.startPlayAfterRobotSoundUpdate = true
-      }
-      else
-      {
-        backend.audioPlayer.togglePlay()
-      }
-    }
-    else
-    {
-      backend.audioPlayer.togglePlay()
-    }
+    // robot sound is synthesized during playback and always up to date
+    backend.audioPlayer.togglePlay()
   }
 
   ScalableSlider{
@@ -246,22 +231,6 @@ Item {
       spacing: Style.fileControl.buttonSpacing * root.height * 0.3
       property var runRobotSound: false
 
-
-      Connections{
-          target: backend
-          onDoneSettingSound:{
-            fileProcess.close()
-            if(robotHumanButtons.runRobotSound){
-              root.robotSoundNeedsUpdate = false
-              if(root.startPlayAfterRobotSoundUpdate)
-              {
-                backend.audioPlayer.togglePlay()
-                root.startPlayAfterRobotSoundUpdate = false
-              }
-            }
-          }
-      }
-
       Item{
         width: playControlItem.height * 1.9
         height: playControlItem.height * 0.7
@@ -337,7 +306,6 @@ Item {
         onPressed: appWindow.grabFocus()
         onClicked:
         {
-          fileProcess.open()
           robotHumanButtons.runRobotSound = true
           backend.setPlayBackForRobots()
         }
@@ -378,7 +346,6 @@ Item {
         onPressed: appWindow.grabFocus()
         onClicked:
         {
-          fileProcess.open()
           robotHumanButtons.runRobotSound = false
           backend.setPlayBackForHumans()
         }
@@ -143,9 +143,9 @@ Item{
     for(var i = 0; i < nChildren; ++i){
       var child = children[0]
       if(child.isFromBar){
-        child.idleParent.model.remove(child.primitive)
+        child.idleParent.parent.model.remove(child.primitive)
       }else{
-        child.destroy()
+        child.idleParent.releaseDelegate()
       }
     }
   }
@@ -158,7 +158,8 @@ Item{
 
     for(var i = 0; i < children.length; ++i){
       // clear it:
-      children[0].idleParent.parent.freeOccupied(children[i].primitive)
+      children[0].idleParent.parent.model.setFloating(children[i].primitive,
+                                                      true)
     }
   }
 
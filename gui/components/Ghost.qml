@@ -27,6 +27,6 @@ Rectangle{
   property bool isValid: false
   color: isValid ? Style.palette.tim_ghostColorValid
                  : Style.palette.tim_ghostColorInvalid
-  height: parent.height
+  height: parent ? parent.height : 0
   radius: Style.primitives.radius
 }
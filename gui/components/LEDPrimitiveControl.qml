@@ -28,7 +28,12 @@ Rectangle{
   id: root
   color: Style.palette.pc_ledBoxBackground
   property var keys: ['led']
-  property var beats: []
+  // dummy beats at the average beat length, with the interface of the
+  // backend's beat model
+  property var beats: ({
+    count: 5,
+    getFrame: function(beat){ return beat * averageBeatFrames }
+  })
   property var primitiveColors: Style.ledPrimitive.colors
   property var primitiveTextIDs: Style.ledPrimitive.textID
   property var delegate: null
@@ -336,7 +341,7 @@ Rectangle{
     if(root.enabled && root.showDragHint){
       showDragHint = false
     }
-    delegate = delegateFactory.createObject(dummyTimerBar)
+    delegate = delegatePool.acquire(dummyTimerBar)
     delegate.dragTarget = ledBar.dragTarget
     delegate.idleParent = root
     delegate.primitive = primitiveFactory.createObject(delegate.id)
@@ -353,7 +358,6 @@ Rectangle{
   Component.onCompleted:{
     // set the first beat at a fixed pixel distance from the left border of the
     // control box:
-    setDummyBeats()
     delegate.updatePrimitive()
   }
 
@@ -363,15 +367,19 @@ Rectangle{
     }
   }
 
-  function setDummyBeats(){
-    for(var i = 0; i < 5; ++i){
-      // add beats at 100 bpm
-      beats[i] = (i * averageBeatFrames)
-    }
+  // recycle the delegate after it was dropped and show a new one
+  function releaseDelegate(){
+    var oldDelegate = delegate
+    oldDelegate.state = ""
+    oldDelegate.showData = false
+    oldDelegate.primitive = null
+    delegatePool.release(oldDelegate)
+    delegate = null
   }
 
-  onAverageBeatFramesChanged:{
-    setDummyBeats();
+  ObjectPool{
+    id: delegatePool
+    component: delegateFactory
   }
 
   Component{
@@ -391,6 +399,7 @@ Rectangle{
     prim.lengthBeat = primOrig.lengthBeat
     prim.frequency = primOrig.frequency
     prim.leds = primOrig.leds
+    prim.seed = primOrig.seed
     return prim
   }
 }
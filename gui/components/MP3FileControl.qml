@@ -135,7 +135,6 @@ Rectangle{
 			onCheckedChanged:
       {
         backend.swapAudioChannels = checked
-        setRobotDataChanged()
         backend.audioPlayer.pause()
         appWindow.grabFocus()
 
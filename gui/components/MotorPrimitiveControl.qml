@@ -34,7 +34,12 @@ Rectangle{
   property bool showDragHint: true
 
   property var delegate: null
-  property var beats: []
+  // dummy beats at the average beat length, with the interface of the
+  // backend's beat model
+  property var beats: ({
+    count: 5,
+    getFrame: function(beat){ return beat * averageBeatFrames }
+  })
   property var averageBeatFrames: appWindow.initAvgBeatFrames
   property int type
 
@@ -630,7 +635,7 @@ Rectangle{
     if(root.enabled && root.showDragHint){
       showDragHint = false
     }
-    delegate = delegateFactory.createObject(dummyTimerBar)
+    delegate = delegatePool.acquire(dummyTimerBar)
     delegate.dragTarget = motorBar.dragTarget
     delegate.idleParent = root
     delegate.isMotor = true
@@ -649,7 +654,6 @@ Rectangle{
   Component.onCompleted:{
     // set the first beat at a fixed pixel distance from the left border of the
     // control box:
-    setDummyBeats()
     delegate.updatePrimitive()
   }
 
@@ -659,15 +663,19 @@ Rectangle{
     }
   }
 
-  function setDummyBeats(){
-    for(var i = 0; i < 5; ++i){
-      // add beats at 100 bpm
-      beats[i] = (i * averageBeatFrames)
-    }
+  // recycle the delegate after it was dropped and show a new one
+  function releaseDelegate(){
+    var oldDelegate = delegate
+    oldDelegate.state = ""
+    oldDelegate.showData = false
+    oldDelegate.primitive = null
+    delegatePool.release(oldDelegate)
+    delegate = null
   }
 
-  onAverageBeatFramesChanged:{
-    setDummyBeats();
+  ObjectPool{
+    id: delegatePool
+    component: delegateFactory
   }
 
   Component{
@@ -35,27 +35,45 @@ Rectangle{
   property bool showData: false
   property bool dragActive: dragArea.dragActive
 
-  property real frameToPixels: appWindow.frameToPixels
+  // positions delegates on the timeline in frames, such that they follow
+  // zooming without bindings; delegates in the control boxes are not zoomed
+  property var timelineLayout: null
+  property real frameToPixels: appWindow.baseFrameToPixels
   property bool isMotor: false
 
   property real beatBarWidth: 0.0
 
-  onFrameToPixelsChanged: updatePrimitive()
+  onFrameToPixelsChanged:{
+    if(!timelineLayout){
+      updatePrimitive()
+    }
+  }
 
   onPrimitiveChanged: updatePrimitive()
 
+  onStateChanged: {
+    // keep the delegate of a selected primitive while it is scrolled out of
+    // view, as it is parented to the dragger
+    if(isFromBar){
+      idleParent.model.setPinned(primitive, state === "onDrag")
+    }
+  }
+
 	function updatePrimitive(){
     // only update if there is a primitive
     if(primitive){
       textID.fullText = primitiveTextIDs[primitive.type]
       color= primitiveColors[primitive.type]
-      x = beats[primitive.positionBeat] * appWindow.frameToPixels
-          - beatBarWidth / 2.0
+      var startFrame = beats.getFrame(primitive.positionBeat)
       var endBeat = primitive.positionBeat + primitive.lengthBeat
-      endBeat = endBeat < beats.length ? endBeat : beats.length - 1
-      width = (beats[endBeat]
-              - beats[primitive.positionBeat]) * appWindow.frameToPixels
-              + beatBarWidth
+      endBeat = endBeat < beats.count ? endBeat : beats.count - 1
+      var endFrame = beats.getFrame(endBeat)
+      if(timelineLayout){
+        timelineLayout.place(root, startFrame, endFrame, beatBarWidth / 2.0)
+      }else{
+        x = startFrame * frameToPixels - beatBarWidth / 2.0
+        width = (endFrame - startFrame) * frameToPixels + beatBarWidth
+      }
       updateToolTip()
     }
 	} // update primitive
@@ -170,27 +188,16 @@ Rectangle{
           newLength = 1
         }
         if(newLength < parent.primitive.lengthBeat){
-          // decrease size:
-          idleParent.parent.freeOccupied(parent.primitive)
+          // decrease size, the model updates occupancy:
           parent.primitive.lengthBeat = newLength
-          idleParent.parent.setOccupied(parent.primitive)
           parent.updatePrimitive()
         }else if(newLength > parent.primitive.lengthBeat){
-          // check if there is space:
-          var start = parent.primitive.positionBeat + parent.primitive.lengthBeat
-          var end = parent.primitive.positionBeat + newLength
-          if(end > idleParent.parent.occupied.length - 1){
-            end = idleParent.parent.occupied.length - 1
-          }
-          var notFree = false
-          for(var i = start; i < end; ++i){
-            notFree |= idleParent.parent.occupied[i]
-          }
-
-          if(!notFree){
-            // space available, resize
-            parent.primitive.lengthBeat = end - parent.primitive.positionBeat
-            idleParent.parent.setOccupied(parent.primitive)
+          // extend as far as there is space:
+          var end = parent.primitive.positionBeat + parent.primitive.lengthBeat
+          var extension = idleParent.parent.model.getFreeLength(end,
+                              newLength - parent.primitive.lengthBeat)
+          if(extension > 0){
+            parent.primitive.lengthBeat += extension
             parent.updatePrimitive()
           }
         }
@@ -293,11 +300,21 @@ Rectangle{
     border.width: Style.primitives.borderWidth * height
   }
 
-  function updateToolTip(){
-    toolTip.update()
+  // tool tips are shared by all delegates and only held while shown
+  property var toolTip: null
+
+  onShowDataChanged:{
+    if(showData && !toolTip){
+      toolTip = toolTipPool.acquire(root)
+    }else if(!showData && toolTip){
+      toolTipPool.release(toolTip)
+      toolTip = null
+    }
   }
 
-  PrimitiveToolTip{
-    id: toolTip
+  function updateToolTip(){
+    if(toolTip){
+      toolTip.update()
+    }
   }
 }
@@ -23,18 +23,26 @@ import "../GuiStyle"
 
 Rectangle{
   id: root
-  anchors.top: (parent.isMotor || !parent.isFromBar) ? undefined : parent.bottom
-  anchors.bottom: (parent.isMotor || !parent.isFromBar) ? parent.top : undefined
+  // the tool tip is recycled, see toolTipPool, and shows the primitive of
+  // the delegate it is parented to
+  property var primitive: parent ? parent.primitive : null
+  property bool isMotor: parent ? parent.isMotor : false
+  property bool showBelow: parent ? !isMotor && parent.isFromBar : false
+  property real delegateHeight: parent ? parent.height : 0
+
+  anchors.top: showBelow ? parent.bottom : undefined
+  anchors.bottom: parent && !showBelow ? parent.top : undefined
   // visible is disabled if a drag is active or if there is no primitive data
   // it is enabled under the above if showData is triggered through a hover
-  visible: !parent.dragActive && primitive && parent.showData
+  visible: parent !== null && !parent.dragActive && primitive !== null
+           && parent.showData
   color: Style.palette.prim_toolTipBackground
-  width: parent.isMotor ? motorColumn.width : ledColumn.width
-  height: parent.isMotor ? motorColumn.height : ledColumn.height
-  radius: parent.radius
+  width: isMotor ? motorColumn.width : ledColumn.width
+  height: isMotor ? motorColumn.height : ledColumn.height
+  radius: parent ? parent.radius : 0
 
-  property real padding: parent.height * Style.primitives.toolTipPadding
-  property real fontSize: parent.height * Style.primitives.toolTipFontSize
+  property real padding: delegateHeight * Style.primitives.toolTipPadding
+  property real fontSize: delegateHeight * Style.primitives.toolTipFontSize
 
   onVisibleChanged: {
     if(visible){
@@ -45,13 +53,16 @@ Rectangle{
   function update(){
     // only update if visible
     if(visible){
-      // only update relevant portion
-      if(parent.isMotor){
+      // only update relevant portion, the tool tip may have shown the other
+      // kind of primitive before
+      if(isMotor){
         // doing this because there was an issue with property binding
+        ledColumn.visible = false
         motorColumn.visible = true
         motorColumn.update()
       }else{
         // doing this because there was an issue with property binding
+        motorColumn.visible = false
         ledColumn.visible = true
         ledColumn.update()
       }
@@ -102,7 +113,7 @@ Rectangle{
     }
     Text{
       id: dirText
-      visible: {motorColumn.visible
+      visible: {motorColumn.visible && primitive !== null
                && (primitive.type === MotorPrimitive.Type.Twist
                || primitive.type === MotorPrimitive.Type.BackAndForth)}
       font.pixelSize: root.fontSize
@@ -116,7 +127,7 @@ Rectangle{
     }
     Text{
       id: motFreq
-      visible: motorColumn.visible
+      visible: motorColumn.visible && primitive !== null
         && primitive.type !== MotorPrimitive.Type.Spin
         && primitive.type !== MotorPrimitive.Type.Straight
         && primitive.type !== MotorPrimitive.Type.Custom
@@ -125,7 +136,7 @@ Rectangle{
     }
     Text{
       id: velRightText
-      visible: {motorColumn.visible
+      visible: {motorColumn.visible && primitive !== null
                && primitive.type === MotorPrimitive.Type.Custom}
       font.pixelSize: root.fontSize
       color: Style.palette.prim_toolTipFont
@@ -149,7 +160,7 @@ Rectangle{
 
     Text{
       id: ledFreqText
-      visible: ledColumn.visible
+      visible: ledColumn.visible && primitive !== null
         && primitive.type !== LEDPrimitive.Type.Constant
       text: "Freq: 1.00"
       font.pixelSize: root.fontSize
@@ -158,7 +169,7 @@ Rectangle{
 
     Row{
       id: ledRow
-      visible: { ledColumn.visible
+      visible: { ledColumn.visible && primitive !== null
         && primitive.type !== LEDPrimitive.Type.KnightRider
         && primitive.type !== LEDPrimitive.Type.Random
       }
@@ -176,7 +187,7 @@ Rectangle{
         id: ledRepeater
         model: 8
         delegate: Rectangle{
-          width: Style.primitives.ledToolTipLEDSize * root.parent.height
+          width: Style.primitives.ledToolTipLEDSize * root.delegateHeight
           height: width
           radius: width / 2
           color: Style.palette.prim_toolTipLEDoff
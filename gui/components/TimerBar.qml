@@ -22,20 +22,19 @@ import dancebots.backend 1.0
 
 import "../GuiStyle"
 
-Canvas{
+Item{
   id: root
   height: Style.timerBar.height * appWindow.width
 
   property color color
-  property var occupied: []
   property var keys
   property var model
   property var primitiveColors
   property var primitiveTextIDs
   property var ghosts: []
-  property var beats: []
+  property var beats: backend.beats
   property var controlBox: null
-  property bool isNotEmpty: primitiveView.count > 0
+  property bool isNotEmpty: model ? model.count > 0 : false
   property bool isMotorBar: false
   property var primitiveY: appWindow.width*Style.timerBar.height * (1.0 - Style.primitives.height)/2
 
@@ -52,18 +51,9 @@ Canvas{
 	  target: backend
 	  onDoneLoading:{
       if(result){
-        // pre-create a few ghosts:
-        createGhosts(10);
         // resize rectangle to fit song
         lengthInFrames = backend.getAudioLengthInFrames()
         timeIndicator.visible = true
-        beats=backend.getBeats()
-        requestPaint();
-        // clear occupancy array:
-        occupied.length = 0
-        for(var i = 0; i < beats.length; ++i){
-          occupied.push(false)
-        }
       }
     }
   }
@@ -75,20 +65,18 @@ Canvas{
 
     function doDrop(){
       if(drag.source.children[0].isFromBar){
-        // source is timerbar itself, just update primitive and
-        // set location beats to occupied
+        // source is timerbar itself, just update primitive, the model
+        // already set the location beats to occupied
         for(var i=0; i < drag.source.children.length; ++i){
           drag.source.children[i].y = root.y
               + primitiveY
           drag.source.children[i].updatePrimitive();
-          setOccupied(drag.source.children[i].primitive)
         }
       }else{
-        // source is control box, add it to model and destroy delegate
+        // source is control box, add it to model and recycle delegate
         model.add(drag.source.children[0].primitive)
-        drag.source.children[0].destroy()
-        // don't have to update occupied as this happens from repeater
-        // callback onItemAdded
+        drag.source.children[0].idleParent.releaseDelegate()
+        // don't have to update occupied as the model does so when adding
       }
     }
 
@@ -107,12 +95,12 @@ Canvas{
             ghosts[i].visible = false
             drag.source.children[i].updatePrimitive();
             // and reset occupied
-            setOccupied(drag.source.children[i].primitive)
+            model.setFloating(drag.source.children[i].primitive, false)
           }
         }
       }else{
-        // if source is control box, delete the (always single) primitive
-        drag.source.children[0].destroy()
+        // if source is control box, discard the (always single) primitive
+        drag.source.children[0].idleParent.releaseDelegate()
       }
     }
 
@@ -134,24 +122,35 @@ Canvas{
           positions.push(startBeat)
           // hide ghosts in any case
           ghosts[i].visible = false
-          var validLength = getValidLength(startBeat, primitive.lengthBeat)
+          var validLength = model.getFreeLength(startBeat, primitive.lengthBeat)
           lengths.push(validLength)
           if(validLength <= 0){
             allValid = false
             break
           }
         }
-        if(allValid){
-          // set all positions and lengths:
+        if(allValid && drag.source.children[0].isFromBar){
+          // move and resize all primitives at once, which fails if they
+          // overlap each other:
+          model.beginBatch()
           for(var j = 0; j < drag.source.children.length; ++j){
-            drag.source.children[j].primitive.positionBeat = positions[j]
-            drag.source.children[j].primitive.lengthBeat = lengths[j]
+            model.setBatchRange(drag.source.children[j].primitive,
+                                positions[j], lengths[j])
           }
+          allValid = model.commitBatch()
+        }else if(allValid){
+          // single primitive from the control box, not in the model yet
+          primitive.positionBeat = positions[0]
+          primitive.lengthBeat = lengths[0]
+        }
+        if(allValid){
           doDrop()
+          releaseGhosts()
           return
         }
       }
       handleInvalidDrop()
+      releaseGhosts()
     }
 
     onEntered:{
@@ -168,15 +167,13 @@ Canvas{
       if(beatLoc >= 0){
         // update beat indicator:
         beatIndicator.text = beatLoc
-        beatIndicator.x = beats[beatLoc] * appWindow.frameToPixels
+        beatIndicator.x = beats.getFrame(beatLoc) * appWindow.frameToPixels
       }
       beatIndicator.visible = true
     }
 
     onExited:{
-      for(var i = 0; i < drag.source.children.length; ++i){
-        ghosts[i].visible = false
-      }
+      releaseGhosts()
       beatIndicator.visible = false
     }
 
@@ -188,7 +185,7 @@ Canvas{
       if(beatLoc >= 0){
         // update beat indicator:
         beatIndicator.text = beatLoc
-        beatIndicator.x = beats[beatLoc] * appWindow.frameToPixels
+        beatIndicator.x = beats.getFrame(beatLoc) * appWindow.frameToPixels
       }
 
       // update ghosts for each child in dragger
@@ -197,12 +194,13 @@ Canvas{
         var primitive = drag.source.children[i].primitive
         var startBeat = beatLoc + primitive.positionBeat - beatOffset
         ghosts[i].visible = true
-        ghosts[i].x = beats[startBeat] * appWindow.frameToPixels
+        ghosts[i].x = beats.getFrame(startBeat) * appWindow.frameToPixels
 
-        var validLength = getValidLength(startBeat, primitive.lengthBeat)
+        var validLength = model.getFreeLength(startBeat, primitive.lengthBeat)
         if(validLength > 0){
           ghosts[i].isValid = true
-          var endPixel = beats[startBeat + validLength] * appWindow.frameToPixels
+          var endPixel = beats.getFrame(startBeat + validLength)
+                         * appWindow.frameToPixels
           ghosts[i].width = endPixel - ghosts[i].x
         }else{
           ghosts[i].isValid = false
@@ -210,32 +208,36 @@ Canvas{
 
         // check if length of drag shape can be corrected:
         var end = primitive.lengthBeat + startBeat
-        if(end < beats.length){
-          drag.source.children[i].width= (beats[end] - beats[startBeat])
+        if(end < beats.count){
+          drag.source.children[i].width= (beats.getFrame(end)
+                                          - beats.getFrame(startBeat))
             * appWindow.frameToPixels;
         }
       }
     }
   }
 
-  function getValidLength(start, length){
-    // if primitive start is out of bounds, return 0, no valid length found
-    if(start < 0 || start > occupied.length - 1){
-      return 0
-    }
-    var validLength = 0
-    var end = start + length;
-    if(end > occupied.length - 1){
-      end = occupied.length - 1;
-    }
-    for(var j = start; j < end; ++j){
-      if(!occupied[j]){
-        ++validLength;
-      }else{
-        break;
-      }
-    }
-    return validLength;
+  // visible part of the bar, which the scene graph items below cover only,
+  // such that drawing cost does not depend on song length or zoom
+  property real viewX: Math.max(0, Math.min(
+    timerBarFlickable.contentX, root.width - timerBarFlickable.width))
+  property real viewWidth: Math.min(timerBarFlickable.width, root.width)
+
+  TimelineItem{
+    id: timeline
+    x: root.viewX
+    width: root.viewWidth
+    height: root.height
+    beats: root.beats
+    peaks: backend.waveformPeaks
+    frameToPixels: appWindow.frameToPixels
+    startFrame: x / frameToPixels
+    color: root.color
+    barColor: Style.palette.tim_barShading
+    beatColor: Style.palette.tim_beatMarks
+    beatWidth: root.beatBarLineWidth
+    waveformColor: Style.palette.tim_waveform
+    waveformRmsColor: Style.palette.tim_waveformRms
   }
 
   Rectangle{
@@ -256,12 +258,31 @@ Canvas{
     }
   }
 
+  // primitives intersecting the visible part of the bar and half a view
+  // width on either side, such that only their delegates are created
+  PrimitiveRangeFilter{
+    id: visiblePrimitives
+    primitives: root.model
+    beats: root.beats
+    startFrame: (root.viewX - root.viewWidth / 2) / root.frameToPixels
+    endFrame: (root.viewX + 1.5 * root.viewWidth) / root.frameToPixels
+  }
+
+  // delegates are placed in frames and re-laid out lazily when zooming
+  TimelineLayout{
+    id: primitiveLayout
+    frameToPixels: root.frameToPixels
+    viewStartFrame: visiblePrimitives.startFrame
+    viewEndFrame: visiblePrimitives.endFrame
+  }
+
   Repeater{
     id: primitiveView
-    model: parent.model
+    model: visiblePrimitives
     PrimitiveDelegate{
       primitive: model.item
       idleParent: primitiveView
+      timelineLayout: primitiveLayout
       isFromBar: true
       dragTarget: root.dragTarget
       y: primitiveY
@@ -269,62 +290,28 @@ Canvas{
       beatBarWidth: beatBarLineWidth
     }
 
-    onItemRemoved: {
-      freeOccupied(item.primitive)
-    }
-
-    onItemAdded: {
-      setOccupied(item.primitive)
-    }
-
     function duplicateItem(item){
       var prim = controlBox.duplicatePrimitive(item.primitive)
       parent.model.add(prim)
     }
   }
 
-  function setOccupied(primitive){
-    setRobotDataChanged()
-    var end = primitive.positionBeat + primitive.lengthBeat;
-    for(var i = primitive.positionBeat; i < end; ++i){
-      occupied[i] = true;
-    }
-  }
-
-  function freeOccupied(primitive){
-    setRobotDataChanged()
-    var end = primitive.positionBeat + primitive.lengthBeat;
-    for(var i = primitive.positionBeat; i < end; ++i){
-      occupied[i] = false;
-    }
-  }
-
-  onPaint: {
-    var ctx = getContext("2d")
-    ctx.fillStyle = color
-    ctx.fillRect(0, 0, width, height)
-    for(var i=0; i < beats.length; i++){
-      ctx.lineWidth = beatBarLineWidth
-      ctx.strokeStyle = Style.palette.tim_beatMarks
-      ctx.beginPath()
-      var loc = beats[i] * appWindow.frameToPixels
-      ctx.moveTo(loc, 0)
-      ctx.lineTo(loc, height)
-      ctx.stroke()
-    }
-  }
-
   function createGhosts(desiredNumber){
     for(var i = ghosts.length; i < desiredNumber; ++i){
-      var newGhost = ghostFactory.createObject(root)
+      var newGhost = ghostPool.acquire(root)
+      newGhost.visible = false
       newGhost.anchors.verticalCenter = root.verticalCenter
       ghosts.push(newGhost)
     }
   }
 
-  Component{
-      id: ghostFactory
-      Ghost{}
+  // hide the ghosts and return them to the pool shared with the other bar
+  function releaseGhosts(){
+    for(var i = 0; i < ghosts.length; ++i){
+      ghosts[i].visible = false
+      ghostPool.release(ghosts[i])
+    }
+    ghosts = []
   }
 
   property var dragTarget: null
@@ -22,8 +22,16 @@
 #include <QQmlContext>
 #include <QtSvg>
 
+#include "src/audio_player.h"
 #include "src/backend.h"
+#include "src/beat_model.h"
+#include "src/object_pool.h"
+#include "src/playhead_item.h"
 #include "src/primitive.h"
+#include "src/primitive_range_filter.h"
+#include "src/timeline_item.h"
+#include "src/timeline_layout.h"
+#include "src/waveform_peaks.h"
 
 int main(int argc, char* argv[]) {
   QCoreApplication::setOrganizationName("MINT&Pepper");
@@ -34,6 +42,20 @@ int main(int argc, char* argv[]) {
 
   qmlRegisterType<MotorPrimitive>("dancebots.backend", 1, 0, "MotorPrimitive");
   qmlRegisterType<LEDPrimitive>("dancebots.backend", 1, 0, "LEDPrimitive");
+  qmlRegisterType<ObjectPool>("dancebots.backend", 1, 0, "ObjectPool");
+  qmlRegisterType<PlayheadItem>("dancebots.backend", 1, 0, "PlayheadItem");
+  qmlRegisterType<PrimitiveRangeFilter>("dancebots.backend", 1, 0,
+                                        "PrimitiveRangeFilter");
+  qmlRegisterType<TimelineItem>("dancebots.backend", 1, 0, "TimelineItem");
+  qmlRegisterType<TimelineLayout>("dancebots.backend", 1, 0,
+                                  "TimelineLayout");
+  qmlRegisterUncreatableType<WaveformPeaks>("dancebots.backend", 1, 0,
+                                            "WaveformPeaks",
+                                            "Provided by backend");
+  qmlRegisterUncreatableType<AudioPlayer>("dancebots.backend", 1, 0,
+                                          "AudioPlayer", "Provided by backend");
+  qmlRegisterUncreatableType<BeatModel>("dancebots.backend", 1, 0, "BeatModel",
+                                        "Provided by backend");
 
   QQmlApplicationEngine engine;
   engine.rootContext()->setContextProperty("backend", &backend);
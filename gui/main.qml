@@ -21,6 +21,7 @@ import QtQuick 2.6
 import QtQuick.Controls 2.12
 import QtQuick.Dialogs 1.3
 import QtQuick.Window 2.1
+import dancebots.backend 1.0
 
 import "components"
 import "GuiStyle"
@@ -46,7 +47,7 @@ ApplicationWindow {
 
   onWidthChanged:{
     if(backend.mp3Loaded && backend.getAverageBeatFrames() > 0){
-      frameToPixels = width * Style.timerBar.beatSpacing
+      baseFrameToPixels = width * Style.timerBar.beatSpacing
                                     / backend.getAverageBeatFrames()
     }
   }
@@ -65,7 +66,10 @@ ApplicationWindow {
 
   property int initAvgBeatFrames: 23000 // daft punk get lucky value
   property real avgBeatWidth: width * Style.timerBar.beatSpacing
-  property real frameToPixels: avgBeatWidth / initAvgBeatFrames
+  // frame to pixel factor of the timeline without zoom
+  property real baseFrameToPixels: avgBeatWidth / initAvgBeatFrames
+  property real zoom: 1.0
+  property real frameToPixels: baseFrameToPixels * zoom
 
   property real guiMargin: width * Style.main.margin
 
@@ -74,7 +78,8 @@ Connections{
   onDoneLoading:{
     if(result && backend.getAverageBeatFrames() > 0){
       // adjust frame to Pixels to get beat spacing independent of bpm
-      frameToPixels = avgBeatWidth / backend.getAverageBeatFrames()
+      baseFrameToPixels = avgBeatWidth / backend.getAverageBeatFrames()
+      zoom = 1.0
     }
   }
 }
@@ -88,6 +93,19 @@ Connections{
     enabled: backend.mp3Loaded
   }
 
+  // items recycled by the timer bars and primitive delegates instead of
+  // creating and destroying them during drag sessions
+  ObjectPool{
+    id: ghostPool
+    component: Component{ Ghost{} }
+    Component.onCompleted: reserve(10)
+  }
+
+  ObjectPool{
+    id: toolTipPool
+    component: Component{ PrimitiveToolTip{} }
+  }
+
   FileProcessPopup{
     id: fileProcess
   }
@@ -143,9 +161,6 @@ Connections{
 
     onContentWidthChanged: {
       contentX = visibleArea.xPosition * contentWidth
-      timeIndicator.position = sliderPosition
-                               * motorBar.lengthInFrames
-                               * appWindow.frameToPixels;
       faders.contentWidth = contentWidth
     }
 
@@ -213,6 +228,29 @@ Connections{
 
     property real scrollMargin: Style.timerBar.scrollMargin * appWindow.width
 
+    // zoom by a factor, keeping the frame at a position of the view fixed
+    function zoomAt(factor, viewX){
+      var zoom = Math.max(Style.timerBar.minZoom,
+                          Math.min(Style.timerBar.maxZoom,
+                                   appWindow.zoom * factor))
+      if(zoom === appWindow.zoom){
+        return
+      }
+      var frame = (contentX + viewX) / appWindow.frameToPixels
+      appWindow.zoom = zoom
+      var newContentX = frame * appWindow.frameToPixels - viewX
+      contentX = Math.max(0, Math.min(contentWidth - width, newContentX))
+    }
+
+    PinchArea{
+      anchors.fill: parent
+      enabled: backend.mp3Loaded
+      onPinchUpdated:{
+        timerBarFlickable.zoomAt(pinch.scale / pinch.previousScale,
+                                 pinch.center.x - timerBarFlickable.contentX)
+      }
+    }
+
     function processMouseMove(minX, maxX){
       if(minX - timerBarFlickable.contentX
           < timerBarFlickable.scrollMargin){
@@ -250,24 +288,27 @@ Connections{
             propagateComposedEvents = true
         }
       }
+      onWheel: {
+        // zoom with control held, scroll otherwise:
+        if(wheel.modifiers & Qt.ControlModifier){
+          timerBarFlickable.zoomAt(
+            Math.pow(Style.timerBar.zoomStep, wheel.angleDelta.y / 120.0),
+            wheel.x - timerBarFlickable.contentX)
+        }else{
+          wheel.accepted = false
+        }
+      }
       enabled: backend.mp3Loaded
     }
 
-    property real sliderPosition: audioControl.sliderPosition
-
-    onSliderPositionChanged:{
-      // set time indicator position
-      timeIndicator.position=sliderPosition
-      * motorBar.lengthInFrames * appWindow.frameToPixels;
-      // update visible range only if drag is not active
-      if(!dragActive){
-      // get current visible pixel range:
-      if(timeIndicator.position < contentX
-          || timeIndicator.position > contentX + width){
-          var proposedContentX = timeIndicator.position -
-            Style.timerBar.timeBarScrollOffset;
-          contentX = proposedContentX < 0 ? 0 : proposedContentX;
-          }
+    Connections{
+      target: audioControl
+      onSliderPositionChanged:{
+        // the playhead follows the slider while it is dragged:
+        if(audioControl.sliderPressed){
+          timeIndicator.showFrame(audioControl.sliderPosition
+                                  * motorBar.lengthInFrames)
+        }
       }
     }
 
@@ -280,7 +321,7 @@ Connections{
         keys: ["mot"]
         model: backend.motorPrimitives
         lengthInFrames: (fileControl.width + motorPrimitiveControl.width
-         + ledPrimitiveControl.width) / frameToPixels
+         + ledPrimitiveControl.width) / appWindow.baseFrameToPixels
         dragTarget: motDragger
         isMotorBar: true
         primitiveColors: Style.motorPrimitive.colors
@@ -319,15 +360,20 @@ Connections{
       }
     }
 
-    Rectangle{
+    PlayheadItem{
       id: timeIndicator
+      width: motorBar.width
+      height: timerBarColumn.height
+      audioPlayer: backend.audioPlayer
+      followPlayer: !audioControl.sliderPressed
+      frameToPixels: appWindow.frameToPixels
       color: Style.palette.tim_timeIndicator
-      width: Style.timerBar.timeBarWidth * motorBar.height
-      height: timerBarColumn.height * Style.timerBar.timeBarHeight
-      radius: width / 2.0
-      property var position: 0
-      x: position - width / 2.0
-      y: (timerBarColumn.height - height) / 2.0
+      indicatorWidth: Style.timerBar.timeBarWidth * motorBar.height
+      indicatorHeight: timerBarColumn.height * Style.timerBar.timeBarHeight
+      // keep the playhead in view, unless primitives are dragged:
+      flickable: timerBarFlickable
+      autoScroll: !timerBarFlickable.dragActive
+      scrollOffset: Style.timerBar.timeBarScrollOffset
     }
   } // timer bar flickable
 
@@ -357,10 +403,6 @@ Connections{
     visible: !backend.mp3Loaded
   }
 
-  function setRobotDataChanged(){
-    audioControl.robotSoundNeedsUpdate = true
-  }
-
   function grabFocus(){
     keyCatcher.focus = true
   }
@@ -20,9 +20,12 @@
 #include "src/audio_player.h"
 
 #include <algorithm>
+#include <utility>
 
 AudioPlayer::AudioPlayer(QObject* parent)
-    : QObject{parent}, mRawAudioBuffer(&mRawAudio, this) {}
+    : QObject{parent}, mAudioStream(this) {
+  mClock.start();
+}
 
 void AudioPlayer::resetAudioOutput(const int sampleRate) {
   // use default device for output:
@@ -46,29 +49,12 @@ void AudioPlayer::resetAudioOutput(const int sampleRate) {
 
 void AudioPlayer::setAudioData(const std::vector<float>& leftChannel,
                                const std::vector<float>& rightChannel) {
-  // clear any existing audio data:
-  mRawAudio.clear();
-
-  // create datastream with little endianness
-  QDataStream stream(&mRawAudio, QIODevice::WriteOnly);
-  stream.setByteOrder(mEndianness);
-
   assert(leftChannel.size() == rightChannel.size());
-  mRawAudio.reserve(static_cast<int>(leftChannel.size() * numBytesPerFrame));
-  for (size_t i = 0u; i < leftChannel.size(); ++i) {
-    auto ClampToInt16 = [&](float in) -> qint16 {
-      if (in > 1.0f) in = 1.0f;
-      if (in < -1.0f) in = -1.0f;
-      // convert to int16 and push into stream
-      return static_cast<qint16>(in * 32767.0f);
-    };
-    // LEFT:
-    stream << ClampToInt16(leftChannel[i]);
-    // RIGHT:
-    stream << ClampToInt16(rightChannel[i]);
-  }
-
-  mAudioOutput->setBufferSize(8192);
+  // the stream converts the blocks read by the audio output on the fly
+  mAudioStream.setChannels(&leftChannel, &rightChannel);
+
+  mAudioOutput->setBufferSize(mBufferFrames * numBytesPerFrame);
+  mUnderrunCount = 0;
 
   // set notify interval:
   mAudioOutput->setNotifyInterval(mNotifyInterval);
@@ -85,11 +71,19 @@ void AudioPlayer::setAudioData(const std::vector<float>& leftChannel,
   // connect to handler:
   connectAudioOutputSignals();
 
-  // and open and reset buffer
-  mRawAudioBuffer.open(QIODevice::ReadOnly);
-  mRawAudioBuffer.reset();  // in case of reload, rewind
+  // and open stream unbuffered, such that seeks and data source changes are
+  // not delayed by read ahead
+  mAudioStream.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+  mAudioStream.seekFrame(0, false);  // in case of reload, rewind
+}
+
+void AudioPlayer::setDataSource(AudioStream::DataSource source,
+                                const int channel) {
+  mAudioStream.setDataSource(std::move(source), channel);
 }
 
+void AudioPlayer::clearDataSource(void) { mAudioStream.clearDataSource(); }
+
 qreal AudioPlayer::getCurrentLogVolume(void) {
   if (mAudioOutput) {
     mVolumeLinear = mAudioOutput->volume();
@@ -111,13 +105,13 @@ void AudioPlayer::togglePlay(void) {
   }
 
   // open if necessary
-  if (!mRawAudioBuffer.isOpen()) {
-    mRawAudioBuffer.open(QIODevice::ReadOnly);
+  if (!mAudioStream.isOpen()) {
+    mAudioStream.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
   }
 
   // rewind audio if we are at the end:
-  if (mRawAudioBuffer.atEnd()) {
-    mRawAudioBuffer.reset();
+  if (mAudioStream.atEnd()) {
+    mAudioStream.seekFrame(0, false);
   }
 
   // emit a notify of the new position:
@@ -129,12 +123,18 @@ void AudioPlayer::togglePlay(void) {
       mAudioOutput->suspend();
       break;
     case QAudio::SuspendedState:
+      mSuspendedSeekFrame = -1;
       mAudioOutput->resume();
       break;
     case QAudio::InterruptedState:
     case QAudio::StoppedState:
     case QAudio::IdleState:
-      mAudioOutput->start(&mRawAudioBuffer);
+      // processed time of the output restarts at zero:
+      mAudioStream.resetOutputClock();
+      mAudioOutput->setBufferSize(mBufferFrames * numBytesPerFrame);
+      mAudioOutput->start(&mAudioStream);
+      updateClockAnchor();
+      updateTelemetry();
       break;
   }
 }
@@ -142,7 +142,8 @@ void AudioPlayer::togglePlay(void) {
 void AudioPlayer::stop(const bool emitTimeUpdate) {
   if (mAudioOutput) {
     mAudioOutput->stop();
-    mRawAudioBuffer.reset();
+    mSuspendedSeekFrame = -1;
+    mAudioStream.seekFrame(0, false);
     // emit change of position
     if (emitTimeUpdate) {
       handleAudioOutputNotify();
@@ -156,27 +157,84 @@ void AudioPlayer::pause(void) {
   }
 }
 
-void AudioPlayer::handleAudioOutputNotify(void) {
-  // get current position in buffer and compensate for buffer delay if not at
-  // end (to make sure end is properly displayed by frontend)
-  qint64 pos = 0;
-  if (mRawAudioBuffer.atEnd()) {
-    pos = mRawAudioBuffer.pos();
-  } else {
-    pos = mRawAudioBuffer.pos() - mAudioOutput->bufferSize();
+qint64 AudioPlayer::getCurrentPlaybackFrame(void) const {
+  if (!mAudioOutput || mSampleRate <= 0) {
+    return 0;
+  }
+
+  // the output does not advance while suspended, so the processed time is
+  // stale after a seek. Playback resumes from the frame sought to, after the
+  // few frames still buffered:
+  if (mAudioOutput->state() == QAudio::SuspendedState &&
+      mSuspendedSeekFrame >= 0) {
+    return mSuspendedSeekFrame;
+  }
+
+  switch (mAudioOutput->state()) {
+    case QAudio::ActiveState:
+    case QAudio::SuspendedState:
+    case QAudio::IdleState: {
+      // time processed by the output, interpolated while active:
+      qint64 uSecs = mAnchorUSecs;
+      if (mAudioOutput->state() == QAudio::ActiveState) {
+        uSecs += (mClock.nsecsElapsed() - mAnchorClockNSecs) / 1000;
+      }
+      // cannot play further than read from the stream:
+      const qint64 outputFrame = std::min(uSecs * mSampleRate / 1000000,
+                                          mAudioStream.getOutputFrame());
+      return mAudioStream.getSourceFrame(outputFrame);
+    }
+    case QAudio::InterruptedState:
+    case QAudio::StoppedState:
+      break;
   }
+  return mAudioStream.getReadFrame();
+}
 
-  if (pos < 0) {
-    pos = 0;
+qreal AudioPlayer::getCurrentPlaybackTime(void) const {
+  if (mSampleRate <= 0) {
+    return 0.0;
   }
-  // convert to MS:
-  // 1000 * pos / 4 / SampleRate - /2 for two bytes per frame
-  mTimeMS = 1000 / numBytesPerFrame * pos / mSampleRate;
+  return 1000.0 * static_cast<qreal>(getCurrentPlaybackFrame()) / mSampleRate;
+}
+
+void AudioPlayer::handleAudioOutputNotify(void) {
+  if (!mAudioOutput) {
+    return;
+  }
+  updateClockAnchor();
+  updateTelemetry();
+  mTimeMS = static_cast<int>(getCurrentPlaybackTime());
 
   // and inform subscribers
   emit notify(mTimeMS);
 }
 
+void AudioPlayer::updateClockAnchor(void) {
+  mAnchorUSecs = mAudioOutput->processedUSecs();
+  mAnchorClockNSecs = mClock.nsecsElapsed();
+}
+
+void AudioPlayer::updateTelemetry(void) {
+  const int bufferSize = mAudioOutput->bufferSize();
+  mPeriodFrames = mAudioOutput->periodSize() / numBytesPerFrame;
+  mBufferFill = 0.0;
+  if (bufferSize > 0) {
+    mBufferFill = static_cast<qreal>(bufferSize - mAudioOutput->bytesFree()) /
+                  bufferSize;
+  }
+  mOutputLatencyMS = 0.0;
+  if (mSampleRate > 0 && mAudioOutput->state() != QAudio::StoppedState) {
+    // read from stream but not yet processed by the device:
+    const qreal readUSecs = 1.0e6 *
+                            static_cast<qreal>(mAudioStream.getOutputFrame()) /
+                            mSampleRate;
+    mOutputLatencyMS =
+        std::max(0.0, (readUSecs - mAudioOutput->processedUSecs()) / 1000.0);
+  }
+  emit telemetryChanged();
+}
+
 void AudioPlayer::connectAudioOutputSignals() {
   // state change
   connect(mAudioOutput.get(), SIGNAL(stateChanged(QAudio::State)), this,
@@ -190,13 +248,42 @@ void AudioPlayer::seek(const int timeMS) {
   if (!mAudioOutput || timeMS < 0) {
     return;
   }
-  mAudioOutput->stop();
-  // calculate buffer position based on time, sampling rate
-  const size_t bufferPos =
-      ((static_cast<size_t>(timeMS) * mSampleRate) / 1000) * numBytesPerFrame;
-  if (bufferPos >= 0 && bufferPos < (mRawAudio.size() - 1)) {
-    mRawAudioBuffer.seek(bufferPos);
+  // calculate frame based on time, sampling rate
+  const qint64 frame = (static_cast<qint64>(timeMS) * mSampleRate) / 1000;
+  if (frame >= mAudioStream.getNumFrames()) {
+    return;
   }
+  // keep the output running and crossfade from the audio it still buffers,
+  // such that scrubbing during playback is gapless
+  const QAudio::State state = mAudioOutput->state();
+  const bool running =
+      state == QAudio::ActiveState || state == QAudio::SuspendedState;
+  mAudioStream.seekFrame(frame, running);
+  mSuspendedSeekFrame = state == QAudio::SuspendedState ? frame : -1;
+  // emit a notify of the new position:
+  handleAudioOutputNotify();
+}
+
+void AudioPlayer::setLoopFrames(const int startFrame, const int endFrame) {
+  mAudioStream.setLoop(startFrame, endFrame);
+}
+
+void AudioPlayer::clearLoop(void) { mAudioStream.clearLoop(); }
+
+void AudioPlayer::setPlaybackSpeed(const qreal speed) {
+  const qreal oldSpeed = mAudioStream.getSpeed();
+  mAudioStream.setSpeed(speed);
+  if (mAudioStream.getSpeed() != oldSpeed) {
+    emit playbackSpeedChanged();
+  }
+}
+
+void AudioPlayer::setBufferFrames(const int frames) {
+  if (frames < minBufferFrames || frames == mBufferFrames) {
+    return;
+  }
+  mBufferFrames = frames;
+  emit bufferFramesChanged();
 }
 
 void AudioPlayer::setVolume(const qreal valueLogarithmic) {
@@ -217,6 +304,17 @@ void AudioPlayer::setNotifyInterval(const int intervalMS) {
 
 void AudioPlayer::handleStateChanged(QAudio::State newState) {
   // TODO(PhilippReist): might have to implement error handling here
+  updateClockAnchor();
+
+  // running out of data or being interrupted while playing and before the end
+  // of the stream is an underrun:
+  if (mIsPlaying &&
+      ((newState == QAudio::IdleState && !mAudioStream.atEnd()) ||
+       newState == QAudio::InterruptedState)) {
+    ++mUnderrunCount;
+    updateTelemetry();
+  }
+
   switch (newState) {
     case QAudio::ActiveState:
       mIsPlaying = true;
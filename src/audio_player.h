@@ -20,14 +20,15 @@
 #ifndef SRC_AUDIO_PLAYER_H_
 #define SRC_AUDIO_PLAYER_H_
 
-#include <QBuffer>
-#include <QByteArray>
 #include <QDataStream>
+#include <QElapsedTimer>
 #include <QObject>
 #include <QtMultimedia>
 #include <memory>
 #include <vector>
 
+#include "src/audio_stream.h"
+
 /** \class AudioPlayer
  * \brief Plays back audio from raw data to QAudioOutput
  */
@@ -35,6 +36,14 @@ class AudioPlayer : public QObject {
   Q_OBJECT;
 
   Q_PROPERTY(bool isPlaying READ isPlaying NOTIFY isPlayingChanged)
+  Q_PROPERTY(qreal playbackSpeed READ playbackSpeed WRITE setPlaybackSpeed
+                 NOTIFY playbackSpeedChanged)
+  Q_PROPERTY(int bufferFrames READ bufferFrames WRITE setBufferFrames NOTIFY
+                 bufferFramesChanged)
+  Q_PROPERTY(int periodFrames READ periodFrames NOTIFY telemetryChanged)
+  Q_PROPERTY(int underrunCount READ underrunCount NOTIFY telemetryChanged)
+  Q_PROPERTY(qreal bufferFill READ bufferFill NOTIFY telemetryChanged)
+  Q_PROPERTY(qreal outputLatencyMS READ outputLatencyMS NOTIFY telemetryChanged)
 
  public:
   explicit AudioPlayer(QObject* parent);
@@ -45,16 +54,32 @@ class AudioPlayer : public QObject {
   void resetAudioOutput(const int sampleRate = 44100);
 
   /**
-   * \brief Set the audio data to be played back
+   * \brief Set the audio data to be played back. The data is not copied but
+   * streamed from the vectors, which have to stay valid during playback.
    * 
    * \note Use resetAudioOutput before calling this method.
    *
-   * \param[in] monoData - a vector of float audio data
-   * \param[in] sampleRate - the audio sample rate
+   * \param[in] leftChannel - left channel float audio data
+   * \param[in] rightChannel - right channel float audio data
    */
   void setAudioData(const std::vector<float>& leftChannel,
                     const std::vector<float>& rightChannel);
 
+  /**
+   * \brief Replace one channel of the audio data by a data source, which is
+   * queried for every block of audio played back. Takes effect immediately
+   * and is crossfaded during playback.
+   *
+   * \param[in] source - the data source
+   * \param[in] channel - the channel to replace, 0 for left and 1 for right
+   */
+  void setDataSource(AudioStream::DataSource source, const int channel);
+
+  /**
+   * \brief Play back the audio data set by setAudioData on both channels again
+   */
+  void clearDataSource(void);
+
   /**
    * \brief Get current playback volume in logarithmic representation
    *
@@ -62,12 +87,23 @@ class AudioPlayer : public QObject {
    */
   Q_INVOKABLE qreal getCurrentLogVolume(void);
 
-   /**
-   * \brief Get current playback time in audio buffer in MS
+  /**
+   * \brief Get current playback time in audio buffer in MS. During playback,
+   * the time is interpolated from the audio clock at the last notify, such
+   * that it can be polled for every rendered frame.
    *
    * \return time in MS
    */
-  Q_INVOKABLE qreal getCurrentPlaybackTime(void) const { return mTimeMS; }
+  Q_INVOKABLE qreal getCurrentPlaybackTime(void) const;
+
+  /**
+   * \brief Get the frame of the audio data currently played back, interpolated
+   * like getCurrentPlaybackTime. While suspended after a seek, this is the
+   * frame sought to.
+   *
+   * \return frame in the audio data
+   */
+  qint64 getCurrentPlaybackFrame(void) const;
 
   /**
    * \brief Get current play status
@@ -76,16 +112,73 @@ class AudioPlayer : public QObject {
    */
   bool isPlaying(void) const { return mIsPlaying; }
 
+  /**
+   * \brief Get the playback speed, 1.0 being the original speed
+   */
+  qreal playbackSpeed(void) const { return mAudioStream.getSpeed(); }
+
+  /**
+   * \brief Set the playback speed. The music is time-stretched without
+   * changing its pitch, and a data source is muted at speeds other than 1.0.
+   *
+   * \param[in] speed - the playback speed, clamped to
+   * [AudioStream::minSpeed, AudioStream::maxSpeed]
+   */
+  void setPlaybackSpeed(const qreal speed);
+
+  /**
+   * \brief Get the requested audio output buffer size in frames
+   */
+  int bufferFrames(void) const { return mBufferFrames; }
+
+  /**
+   * \brief Set the audio output buffer size in frames. Takes effect the next
+   * time playback is started. Values below minBufferFrames are ignored.
+   *
+   * \param[in] frames - the buffer size in frames
+   */
+  void setBufferFrames(const int frames);
+
+  /**
+   * \brief Get the period size in frames chosen by the audio output for the
+   * current buffer size, i.e. the block size read from the stream
+   */
+  int periodFrames(void) const { return mPeriodFrames; }
+
+  /**
+   * \brief Get the number of buffer underruns since the audio data was set
+   */
+  int underrunCount(void) const { return mUnderrunCount; }
+
+  /**
+   * \brief Get the fill level of the audio output buffer in [0.0, 1.0] at the
+   * last notify
+   */
+  qreal bufferFill(void) const { return mBufferFill; }
+
+  /**
+   * \brief Get the output latency in MS at the last notify, i.e. the time of
+   * audio read from the stream but not yet processed by the audio device
+   */
+  qreal outputLatencyMS(void) const { return mOutputLatencyMS; }
+
   // NOLINTNEXTLINE
  signals:
   void isPlayingChanged(void);
+  void bufferFramesChanged(void);
+  void playbackSpeedChanged(void);
+
+  /**
+   * \brief Signal emitted when underrun count, buffer fill or latency change
+   */
+  void telemetryChanged(void);
 
   /**
    * \brief Signal to update GUI elements with the current playback time in
    * the audio data.
    * \param[in] currentPosMS - the current position in the audio data in
-   * milliseconds. The current position is compensated for audio buffer lag, and
-   * the notify interval can be set using setNotifyInterval.
+   * milliseconds, as processed by the audio device. The notify interval can be
+   * set using setNotifyInterval.
    */
   void notify(int currentPosMS);
 
@@ -115,11 +208,27 @@ class AudioPlayer : public QObject {
 
   /**
    * \brief Seeks audio data playback buffer to playback time given in MS.
+   * Playback continues from the new position if the output is running, and
+   * notify is emitted.
    *
    * \param[in] timeMS - the time to seek to.
    */
   void seek(const int timeMS);
 
+  /**
+   * \brief Loop playback over a region of the audio data. The wrap is done
+   * at the exact frame without interrupting playback.
+   *
+   * \param[in] startFrame - first frame of the loop
+   * \param[in] endFrame - frame after the last frame of the loop
+   */
+  void setLoopFrames(const int startFrame, const int endFrame);
+
+  /**
+   * \brief Stop looping, playback continues to the end of the audio data
+   */
+  void clearLoop(void);
+
   /**
    * \brief Set volume of audio output
    *
@@ -155,16 +264,36 @@ class AudioPlayer : public QObject {
    */
   void connectAudioOutputSignals();
 
-  const int numBytesPerFrame = 4;
+  /**
+   * \brief Anchor the processed audio time of the output to the monotonic
+   * clock, for interpolation in getCurrentPlaybackTime
+   */
+  void updateClockAnchor(void);
+
+  /**
+   * \brief Measure buffer fill, period size and output latency
+   */
+  void updateTelemetry(void);
+
+  static const int numBytesPerFrame = 4;
+  static const int minBufferFrames = 256;
   bool mIsPlaying = false;
+  int mBufferFrames = 2048;
+  int mPeriodFrames = 0;
+  int mUnderrunCount = 0;
+  qreal mBufferFill = 0.0;
+  qreal mOutputLatencyMS = 0.0;
   qreal mVolumeLinear = 1.0; /**< Audio volume in linear representation */
   int mSampleRate = 0;
   int mTimeMS = 0;
   int mNotifyInterval = 25; /**< Audio time update interval in MS */
   const QDataStream::ByteOrder mEndianness = QDataStream::LittleEndian;
+  QElapsedTimer mClock;         /**< Monotonic clock for interpolation */
+  qint64 mAnchorUSecs = 0;      /**< Processed audio time at anchor */
+  qint64 mAnchorClockNSecs = 0; /**< Monotonic clock time at anchor */
+  qint64 mSuspendedSeekFrame = -1; /**< Frame sought to while suspended */
   std::unique_ptr<QAudioOutput> mAudioOutput;
-  QByteArray mRawAudio;
-  QBuffer mRawAudioBuffer;
+  AudioStream mAudioStream;
 };
 
 #endif  // SRC_AUDIO_PLAYER_H_
@@ -0,0 +1,357 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/audio_stream.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_STREAM_USE_SSE2
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+constexpr double AudioStream::minSpeed;
+constexpr double AudioStream::maxSpeed;
+
+AudioStream::AudioStream(QObject* parent)
+    : QIODevice{parent},
+      mStretchSource{[this](const qint64 startFrame, const size_t nFrames,
+                            float* left, float* right) {
+        // music only, the data signal cannot be stretched
+        renderBlock(Route{}, startFrame, nFrames, left, right);
+      }} {}
+
+void AudioStream::setChannels(const std::vector<float>* left,
+                              const std::vector<float>* right) {
+  QMutexLocker locker(&mSourceMutex);
+  mLeftChannel = left;
+  mRightChannel = right;
+  mNFrames = static_cast<qint64>(std::min(left->size(), right->size()));
+  mFadeRemaining = 0;
+  mLoopStartFrame = 0;
+  mLoopEndFrame = 0;
+  moveReadCursor(0);
+}
+
+void AudioStream::setDataSource(DataSource source, const int channel) {
+  QMutexLocker locker(&mSourceMutex);
+  startCrossfade();
+  mRoute.source = std::move(source);
+  mRoute.channel = channel;
+}
+
+void AudioStream::clearDataSource(void) {
+  QMutexLocker locker(&mSourceMutex);
+  startCrossfade();
+  mRoute.source = nullptr;
+}
+
+void AudioStream::seekFrame(const qint64 frame, const bool crossfade) {
+  QMutexLocker locker(&mSourceMutex);
+  if (crossfade) {
+    startCrossfade();
+  } else {
+    mFadeRemaining = 0;
+  }
+  moveReadCursor(std::max(qint64{0}, std::min(frame, mNFrames)));
+}
+
+void AudioStream::setSpeed(const double speed) {
+  QMutexLocker locker(&mSourceMutex);
+  const double newSpeed = std::max(minSpeed, std::min(speed, maxSpeed));
+  if (newSpeed == mSpeed) {
+    return;
+  }
+  startCrossfade();
+  mSpeed = newSpeed;
+  moveReadCursor(mReadFrame);
+}
+
+double AudioStream::getSpeed(void) const {
+  QMutexLocker locker(&mSourceMutex);
+  return mSpeed;
+}
+
+qint64 AudioStream::getReadFrame(void) const {
+  QMutexLocker locker(&mSourceMutex);
+  return mReadFrame;
+}
+
+qint64 AudioStream::getNumFrames(void) const {
+  QMutexLocker locker(&mSourceMutex);
+  return mNFrames;
+}
+
+void AudioStream::resetOutputClock(void) {
+  QMutexLocker locker(&mSourceMutex);
+  mOutputFrame = 0;
+  mClockAnchors.clear();
+  addClockAnchor();
+}
+
+qint64 AudioStream::getOutputFrame(void) const {
+  QMutexLocker locker(&mSourceMutex);
+  return mOutputFrame;
+}
+
+qint64 AudioStream::getSourceFrame(const qint64 outputFrame) const {
+  QMutexLocker locker(&mSourceMutex);
+  if (mClockAnchors.empty()) {
+    return 0;
+  }
+  // last anchor at or before the output frame:
+  auto anchor = std::upper_bound(
+      mClockAnchors.begin(), mClockAnchors.end(), outputFrame,
+      [](const qint64 frame, const ClockAnchor& a) {
+        return frame < a.outputFrame;
+      });
+  if (anchor != mClockAnchors.begin()) {
+    --anchor;
+  }
+  const qint64 frame =
+      anchor->sourceFrame +
+      std::llround(anchor->speed *
+                   static_cast<double>(outputFrame - anchor->outputFrame));
+  return std::max(qint64{0}, std::min(frame, mNFrames));
+}
+
+qint64 AudioStream::bytesAvailable(void) const {
+  QMutexLocker locker(&mSourceMutex);
+  return (mNFrames - mReadFrame) * numBytesPerFrame +
+         QIODevice::bytesAvailable();
+}
+
+void AudioStream::startCrossfade(void) {
+  // if a crossfade is running already, the new one starts from the mix that
+  // is currently played back
+  mFadeRoute = mRoute;
+  mFadeFrame = mReadFrame;
+  mFadeSpeed = mSpeed;
+  if (mSpeed != 1.0) {
+    mFadeStretcher = mStretcher;
+  }
+  mFadeRemaining = crossfadeFrames;
+}
+
+void AudioStream::addClockAnchor(void) {
+  // a jump replaces anchors that were not read past
+  while (!mClockAnchors.empty() &&
+         mClockAnchors.back().outputFrame >= mOutputFrame) {
+    mClockAnchors.pop_back();
+  }
+  if (mClockAnchors.size() >= maxClockAnchors) {
+    mClockAnchors.erase(mClockAnchors.begin());
+  }
+  mClockAnchors.push_back(ClockAnchor{mOutputFrame, mReadFrame, mSpeed});
+}
+
+void AudioStream::moveReadCursor(const qint64 frame) {
+  mReadFrame = frame;
+  if (mSpeed != 1.0) {
+    mStretcher.reset(mStretchSource, frame, mSpeed);
+  }
+  addClockAnchor();
+}
+
+qint64 AudioStream::getOutputFramesUntil(const qint64 frame) const {
+  if (mSpeed == 1.0) {
+    return std::max(qint64{0}, frame - mReadFrame);
+  }
+  const double remaining =
+      static_cast<double>(frame) - mStretcher.getPosition();
+  return std::max(qint64{0},
+                  static_cast<qint64>(std::ceil(remaining / mSpeed)));
+}
+
+void AudioStream::renderBlock(const Route& route, const qint64 startFrame,
+                              const size_t nFrames, float* left,
+                              float* right) const {
+  // frames before the start or beyond the end of the source are zero:
+  const qint64 first = std::max(qint64{0}, std::min(startFrame, mNFrames));
+  const qint64 last = std::max(
+      first, std::min(startFrame + static_cast<qint64>(nFrames), mNFrames));
+  const size_t offset = static_cast<size_t>(first - startFrame);
+  const size_t nValid = static_cast<size_t>(last - first);
+  std::fill(left, left + nFrames, 0.0f);
+  std::fill(right, right + nFrames, 0.0f);
+  if (nValid > 0) {
+    std::memcpy(left + offset, mLeftChannel->data() + first,
+                nValid * sizeof(float));
+    std::memcpy(right + offset, mRightChannel->data() + first,
+                nValid * sizeof(float));
+  }
+
+  // route data source to its channel:
+  if (route.source && nValid > 0) {
+    float* const target = (route.channel == 0 ? left : right) + offset;
+    route.source(static_cast<size_t>(first), nValid, target);
+  }
+}
+
+void AudioStream::setLoop(const qint64 startFrame, const qint64 endFrame) {
+  QMutexLocker locker(&mSourceMutex);
+  mLoopStartFrame = std::max(qint64{0}, std::min(startFrame, mNFrames));
+  mLoopEndFrame = std::max(mLoopStartFrame, std::min(endFrame, mNFrames));
+}
+
+void AudioStream::clearLoop(void) {
+  QMutexLocker locker(&mSourceMutex);
+  mLoopStartFrame = 0;
+  mLoopEndFrame = 0;
+}
+
+bool AudioStream::isLooping(void) const {
+  return mLoopEndFrame > mLoopStartFrame && mReadFrame < mLoopEndFrame;
+}
+
+void AudioStream::renderStretched(TimeStretcher* stretcher, const Route& route,
+                                  const size_t nFrames, float* left,
+                                  float* right) {
+  stretcher->process(mStretchSource, nFrames, left, right);
+  // mute the data channel, robots cannot follow stretched commands
+  if (route.source) {
+    std::fill_n(route.channel == 0 ? left : right, nFrames, 0.0f);
+  }
+}
+
+void AudioStream::mixCrossfade(float* left, float* right,
+                               const size_t nFrames) {
+  const size_t nFade = std::min(nFrames, mFadeRemaining);
+  if (nFade == 0) {
+    return;
+  }
+  mFadeLeftBuffer.resize(nFade);
+  mFadeRightBuffer.resize(nFade);
+  if (mFadeSpeed == 1.0) {
+    renderBlock(mFadeRoute, mFadeFrame, nFade, mFadeLeftBuffer.data(),
+                mFadeRightBuffer.data());
+  } else {
+    renderStretched(&mFadeStretcher, mFadeRoute, nFade, mFadeLeftBuffer.data(),
+                    mFadeRightBuffer.data());
+  }
+  const size_t fadeStart = crossfadeFrames - mFadeRemaining;
+  for (size_t i = 0; i < nFade; ++i) {
+    const float gain = static_cast<float>(fadeStart + i + 1) /
+                       static_cast<float>(crossfadeFrames + 1);
+    left[i] = gain * left[i] + (1.0f - gain) * mFadeLeftBuffer[i];
+    right[i] = gain * right[i] + (1.0f - gain) * mFadeRightBuffer[i];
+  }
+  mFadeFrame += static_cast<qint64>(nFade);
+  mFadeRemaining -= nFade;
+}
+
+qint64 AudioStream::readData(char* data, qint64 maxSize) {
+  QMutexLocker locker(&mSourceMutex);
+  // a loop never runs out of data:
+  const qint64 nAvailable = isLooping() ? maxSize / numBytesPerFrame
+                                        : getOutputFramesUntil(mNFrames);
+  const size_t nFrames = static_cast<size_t>(
+      std::min(maxSize / numBytesPerFrame, std::max(qint64{0}, nAvailable)));
+  if (nFrames == 0) {
+    return 0;
+  }
+
+  mLeftBuffer.resize(nFrames);
+  mRightBuffer.resize(nFrames);
+
+  // render up to the loop end or the end of the source, wrapping to the loop
+  // start at the exact frame
+  size_t done = 0;
+  while (done < nFrames) {
+    const bool looping = isLooping();
+    const qint64 segmentEnd = looping ? mLoopEndFrame : mNFrames;
+    const qint64 nSegment = getOutputFramesUntil(segmentEnd);
+    const size_t n = static_cast<size_t>(
+        std::min(static_cast<qint64>(nFrames - done), nSegment));
+    float* const left = mLeftBuffer.data() + done;
+    float* const right = mRightBuffer.data() + done;
+    if (mSpeed == 1.0) {
+      renderBlock(mRoute, mReadFrame, n, left, right);
+      mReadFrame += static_cast<qint64>(n);
+    } else {
+      renderStretched(&mStretcher, mRoute, n, left, right);
+      mReadFrame = static_cast<qint64>(n) == nSegment
+                       ? segmentEnd
+                       : std::min(segmentEnd, static_cast<qint64>(std::floor(
+                                                  mStretcher.getPosition())));
+    }
+
+    // linear crossfade from the previous read position or route, which is
+    // still in the output buffer and would otherwise end in a click
+    mixCrossfade(left, right, n);
+
+    mOutputFrame += static_cast<qint64>(n);
+    done += n;
+    if (looping && mReadFrame == mLoopEndFrame) {
+      startCrossfade();
+      moveReadCursor(mLoopStartFrame);
+    }
+  }
+
+  interleave(mLeftBuffer.data(), mRightBuffer.data(), nFrames, data);
+  return static_cast<qint64>(nFrames) * numBytesPerFrame;
+}
+
+void AudioStream::interleave(const float* left, const float* right,
+                             const size_t nFrames, char* out) {
+  size_t i = 0;
+#ifdef AUDIO_STREAM_USE_SSE2
+  // eight frames at a time. Truncating conversion matches the static_cast in
+  // toInt16, and the packing does not saturate as values are clamped before.
+  // x86 is little endian, so the frames can be stored directly.
+  const __m128 maxValue = _mm_set1_ps(1.0f);
+  const __m128 minValue = _mm_set1_ps(-1.0f);
+  const __m128 scale = _mm_set1_ps(32767.0f);
+  auto convert = [&](const float* in) {
+    __m128 x = _mm_loadu_ps(in);
+    x = _mm_min_ps(_mm_max_ps(x, minValue), maxValue);
+    return _mm_cvttps_epi32(_mm_mul_ps(x, scale));
+  };
+  for (; i + 8 <= nFrames; i += 8) {
+    const __m128i l =
+        _mm_packs_epi32(convert(left + i), convert(left + i + 4));
+    const __m128i r =
+        _mm_packs_epi32(convert(right + i), convert(right + i + 4));
+    __m128i* const dst = reinterpret_cast<__m128i*>(out + numBytesPerFrame * i);
+    _mm_storeu_si128(dst, _mm_unpacklo_epi16(l, r));
+    _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(l, r));
+  }
+#endif
+  // remaining frames, or all frames without SSE2:
+  for (; i < nFrames; ++i) {
+    const quint16 l = static_cast<quint16>(toInt16(left[i]));
+    const quint16 r = static_cast<quint16>(toInt16(right[i]));
+    char* const frame = out + numBytesPerFrame * i;
+    frame[0] = static_cast<char>(l & 0xFF);
+    frame[1] = static_cast<char>(l >> 8);
+    frame[2] = static_cast<char>(r & 0xFF);
+    frame[3] = static_cast<char>(r >> 8);
+  }
+}
+
+qint64 AudioStream::writeData(const char* data, qint64 maxSize) {
+  // read-only device
+  Q_UNUSED(data);
+  Q_UNUSED(maxSize);
+  return -1;
+}
@@ -0,0 +1,301 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_AUDIO_STREAM_H_
+#define SRC_AUDIO_STREAM_H_
+
+#include <QIODevice>
+#include <QMutex>
+#include <functional>
+#include <vector>
+
+#include "src/time_stretcher.h"
+
+/** \class AudioStream
+ * \brief Read-only sequential device providing interleaved 16 bit stereo audio
+ * data to QAudioOutput in pull mode.
+ *
+ * The device streams from two float source channels and only converts the
+ * blocks the audio output reads, starting at a read cursor that can be moved
+ * while the output is running. One of the channels can be replaced by a data
+ * source that is queried for every block, such that changes to the source take
+ * effect immediately. A loop region can be set, which is wrapped at the exact
+ * frame while reading. Jumps of the read cursor, loop wraps and changes of the
+ * data source are crossfaded to avoid clicks.
+ */
+class AudioStream : public QIODevice {
+  Q_OBJECT;
+
+ public:
+  /**
+   * \brief Function writing nFrames audio frames starting at startFrame to
+   * signal
+   */
+  using DataSource = std::function<void(const size_t startFrame,
+                                        const size_t nFrames, float* signal)>;
+
+  static constexpr double minSpeed{0.25};  /**< slowest playback speed */
+  static constexpr double maxSpeed{2.0};   /**< fastest playback speed */
+
+  explicit AudioStream(QObject* parent = nullptr);
+
+  /**
+   * \brief Set the source channels to stream from and rewind. The channels are
+   * not copied and have to stay valid while the stream is read.
+   *
+   * \param[in] left - left channel samples
+   * \param[in] right - right channel samples, of the same size as left
+   */
+  void setChannels(const std::vector<float>* left,
+                   const std::vector<float>* right);
+
+  /**
+   * \brief Replace a source channel by a data source. The change is
+   * crossfaded.
+   *
+   * \param[in] source - the data source to read from
+   * \param[in] channel - channel to replace, 0 for left and 1 for right
+   */
+  void setDataSource(DataSource source, const int channel);
+
+  /**
+   * \brief Play source channels on both channels again. The change is
+   * crossfaded.
+   */
+  void clearDataSource(void);
+
+  /**
+   * \brief Move the read cursor to a frame
+   *
+   * \param[in] frame - the frame to continue reading at
+   * \param[in] crossfade - crossfade from the previous read position, e.g.
+   * if the audio output is running and still holds data of that position
+   */
+  void seekFrame(const qint64 frame, const bool crossfade);
+
+  /**
+   * \brief Set the playback speed. Speeds other than 1.0 are time-stretched
+   * without changing the pitch, and the data source channel is muted. The
+   * change is crossfaded.
+   *
+   * \param[in] speed - source frames per output frame, clamped to
+   * [minSpeed, maxSpeed]
+   */
+  void setSpeed(const double speed);
+
+  /**
+   * \brief Get the playback speed
+   */
+  double getSpeed(void) const;
+
+  /**
+   * \brief Get the frame the next block will be read from
+   */
+  qint64 getReadFrame(void) const;
+
+  /**
+   * \brief Get the number of frames of the source channels
+   */
+  qint64 getNumFrames(void) const;
+
+  /**
+   * \brief Restart the output clock, i.e. the count of frames read, at the
+   * current read frame. Call when the audio output is started.
+   */
+  void resetOutputClock(void);
+
+  /**
+   * \brief Get the number of frames read since resetOutputClock
+   */
+  qint64 getOutputFrame(void) const;
+
+  /**
+   * \brief Get the source frame that was read at an output frame, taking
+   * into account the jumps of the read cursor since resetOutputClock
+   *
+   * \param[in] outputFrame - frame count since resetOutputClock
+   */
+  qint64 getSourceFrame(const qint64 outputFrame) const;
+
+  /**
+   * \brief Set a loop region. Reading wraps from the end to the start frame
+   * of the region once the read cursor is before its end, and is crossfaded
+   * at the wrap. An empty region disables looping.
+   *
+   * \param[in] startFrame - first frame of the loop
+   * \param[in] endFrame - frame after the last frame of the loop
+   */
+  void setLoop(const qint64 startFrame, const qint64 endFrame);
+
+  /**
+   * \brief Disable looping
+   */
+  void clearLoop(void);
+
+  bool isSequential(void) const override { return true; }
+  qint64 bytesAvailable(void) const override;
+
+  /**
+   * \brief Convert float sample to 16 bit integer, clamping to [-1.0, 1.0]
+   */
+  static qint16 toInt16(float sample) {
+    if (sample > 1.0f) sample = 1.0f;
+    if (sample < -1.0f) sample = -1.0f;
+    return static_cast<qint16>(sample * 32767.0f);
+  }
+
+  /**
+   * \brief Convert two float channels to interleaved little endian 16 bit
+   * stereo frames, with the same clamping and rounding as toInt16. Uses SSE2
+   * where available.
+   *
+   * \param[in] left - left channel samples
+   * \param[in] right - right channel samples
+   * \param[in] nFrames - number of frames to convert
+   * \param[out] out - output buffer of at least 4 * nFrames bytes
+   */
+  static void interleave(const float* left, const float* right,
+                         const size_t nFrames, char* out);
+
+ protected:
+  /**
+   * \brief Reads whole frames only, i.e. returns a multiple of 4 bytes
+   */
+  qint64 readData(char* data, qint64 maxSize) override;
+  qint64 writeData(const char* data, qint64 maxSize) override;
+
+ private:
+  // Routing of the data source to the output channels
+  struct Route {
+    DataSource source;
+    int channel{1};
+  };
+
+  // source frame read at an output frame, stored at every cursor jump or
+  // change of speed
+  struct ClockAnchor {
+    qint64 outputFrame;
+    qint64 sourceFrame;
+    double speed;
+  };
+
+  static const int numBytesPerFrame{4};
+  static const size_t crossfadeFrames{256};
+  static const size_t maxClockAnchors{64};
+
+  // guards all members below, which are set from the main thread and read
+  // from the audio output
+  mutable QMutex mSourceMutex;
+  const std::vector<float>* mLeftChannel{nullptr};
+  const std::vector<float>* mRightChannel{nullptr};
+  qint64 mNFrames{0};
+  qint64 mReadFrame{0};
+  qint64 mOutputFrame{0};
+  std::vector<ClockAnchor> mClockAnchors;
+  Route mRoute;
+  qint64 mLoopStartFrame{0};
+  qint64 mLoopEndFrame{0};
+  double mSpeed{1.0};
+  TimeStretcher mStretcher;
+  TimeStretcher::Source mStretchSource;
+
+  // previous read position, route and speed faded out during a crossfade,
+  // which is rendered like the block it continues, i.e. stretched by a copy
+  // of the stretcher unless at speed 1.0
+  Route mFadeRoute;
+  qint64 mFadeFrame{0};
+  double mFadeSpeed{1.0};
+  TimeStretcher mFadeStretcher;
+  size_t mFadeRemaining{0};
+
+  // scratch buffers for a block of the current and faded out stream
+  std::vector<float> mLeftBuffer;
+  std::vector<float> mRightBuffer;
+  std::vector<float> mFadeLeftBuffer;
+  std::vector<float> mFadeRightBuffer;
+
+  /**
+   * \brief Start a crossfade from the current read position and route. Call
+   * with mutex locked, before changing either.
+   */
+  void startCrossfade(void);
+
+  /**
+   * \brief Record that the output continues at the current read frame. Call
+   * with mutex locked, after moving the read cursor.
+   */
+  void addClockAnchor(void);
+
+  /**
+   * \brief Continue reading at a frame, restarting the time-stretch there.
+   * Call with mutex locked.
+   */
+  void moveReadCursor(const qint64 frame);
+
+  /**
+   * \brief Get the number of output frames until the read cursor reaches a
+   * source frame at the current speed. Call with mutex locked.
+   */
+  qint64 getOutputFramesUntil(const qint64 frame) const;
+
+  /**
+   * \brief Check if the read cursor is in or before an active loop region.
+   * Call with mutex locked.
+   */
+  bool isLooping(void) const;
+
+  /**
+   * \brief Render a block of time-stretched music, with the channel of a
+   * routed data source muted, as robots cannot follow stretched commands.
+   * Call with mutex locked.
+   *
+   * \param[in,out] stretcher - the stretcher to read the block from
+   * \param[in] route - the data source routing
+   * \param[in] nFrames - number of frames
+   * \param[out] left - buffer for left channel, at least nFrames long
+   * \param[out] right - buffer for right channel, at least nFrames long
+   */
+  void renderStretched(TimeStretcher* stretcher, const Route& route,
+                       const size_t nFrames, float* left, float* right);
+
+  /**
+   * \brief Mix a running crossfade into a block rendered at the read cursor.
+   * Call with mutex locked.
+   *
+   * \param[in,out] left - left channel of the block
+   * \param[in,out] right - right channel of the block
+   * \param[in] nFrames - number of frames of the block
+   */
+  void mixCrossfade(float* left, float* right, const size_t nFrames);
+
+  /**
+   * \brief Render a block of frames of the source channels with a route.
+   * Frames beyond the source channels are zero.
+   *
+   * \param[in] route - the data source routing
+   * \param[in] startFrame - first frame of the block
+   * \param[in] nFrames - number of frames
+   * \param[out] left - left channel output of at least nFrames
+   * \param[out] right - right channel output of at least nFrames
+   */
+  void renderBlock(const Route& route, const qint64 startFrame,
+                   const size_t nFrames, float* left, float* right) const;
+};
+
+#endif  // SRC_AUDIO_STREAM_H_
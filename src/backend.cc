@@ -26,13 +26,54 @@
 #include <QEventLoop>
 #include <QSettings>
 #include <QThread>
+#include <QTimer>
 #include <QtConcurrent>
 #include <QtDebug>
 
+#include <algorithm>
+
 #include "src/primitive.h"
-#include "src/primitive_to_signal.h"
 #include "src/utils.h"
 
+namespace {
+// Copy primitives, such that a worker thread can read the copies while the
+// originals are edited
+QList<QObject*> copyMotorPrimitives(const QList<QObject*>& primitives) {
+  QList<QObject*> copies;
+  copies.reserve(primitives.size());
+  for (const QObject* const qo : primitives) {
+    const MotorPrimitive* const mp =
+        reinterpret_cast<const MotorPrimitive*>(qo);
+    MotorPrimitive* const copy = new MotorPrimitive();
+    copy->mPositionBeat = mp->mPositionBeat;
+    copy->mLengthBeat = mp->mLengthBeat;
+    copy->mFrequency = mp->mFrequency;
+    copy->mVelocity = mp->mVelocity;
+    copy->mVelocityRight = mp->mVelocityRight;
+    copy->mType = mp->mType;
+    copies.append(copy);
+  }
+  return copies;
+}
+
+QList<QObject*> copyLedPrimitives(const QList<QObject*>& primitives) {
+  QList<QObject*> copies;
+  copies.reserve(primitives.size());
+  for (const QObject* const qo : primitives) {
+    const LEDPrimitive* const lp = reinterpret_cast<const LEDPrimitive*>(qo);
+    LEDPrimitive* const copy = new LEDPrimitive();
+    copy->mPositionBeat = lp->mPositionBeat;
+    copy->mLengthBeat = lp->mLengthBeat;
+    copy->mFrequency = lp->mFrequency;
+    copy->mLeds = lp->mLeds;
+    copy->mType = lp->mType;
+    copy->mSeed = lp->mSeed;
+    copies.append(copy);
+  }
+  return copies;
+}
+}  // namespace
+
 BackEnd::BackEnd(QObject* parent)
     : QObject{parent},
       mFileStatus{"Idle"},
@@ -41,20 +82,25 @@ BackEnd::BackEnd(QObject* parent)
       mBeatDetector{static_cast<unsigned int>(mAudioFile.sampleRate)},
       mLoadFuture{},
       mLoadFutureWatcher{},
-      mSoundSetFuture{},
-      mSoundSetFutureWatcher{},
       mSaveFuture{},
       mSaveFutureWatcher{},
       mMotorPrimitives{new PrimitiveList{this}},
-      mLedPrimitives{new PrimitiveList{this}} {
+      mLedPrimitives{new PrimitiveList{this}},
+      mWaveformPeaks{new WaveformPeaks{this}},
+      mBeatModel{new BeatModel{this}} {
   // connect load and save thread finish signal to backend handler slots
   connect(&mLoadFutureWatcher, &QFutureWatcher<bool>::finished, this,
           &BackEnd::handleDoneLoading);
-  connect(&mSoundSetFutureWatcher, &QFutureWatcher<bool>::finished, this,
-          &BackEnd::handleDoneSettingSound);
   connect(&mSaveFutureWatcher, &QFutureWatcher<bool>::finished, this,
           &BackEnd::handleDoneSaving);
 
+  // keep commands of data signal up to date with primitives:
+  connect(mMotorPrimitives, &PrimitiveList::dirtyRangeChanged, this,
+          &BackEnd::scheduleCollectDirtyBeats);
+  connect(mLedPrimitives, &PrimitiveList::dirtyRangeChanged, this,
+          &BackEnd::scheduleCollectDirtyBeats);
+  mGeneratePool.setMaxThreadCount(1);
+
   // see if there is a config file and parse it if available
   QFile iniFile(mConfigFileName);
   bool swapAudio = false;
@@ -65,6 +111,11 @@ BackEnd::BackEnd(QObject* parent)
         iniSettings.contains("audio/swapChannels")) {
       swapAudio = iniSettings.value("audio/swapChannels", false).toBool();
     }
+    if (iniSettings.status() == QSettings::NoError &&
+        iniSettings.contains("audio/bufferFrames")) {
+      mAudioPlayer->setBufferFrames(
+          iniSettings.value("audio/bufferFrames").toInt());
+    }
   }
   mAudioFile.setSwapChannels(swapAudio);
 }
@@ -80,6 +131,7 @@ bool BackEnd::swapAudioChannels() { return mAudioFile.getSwapChannels(); }
 
 void BackEnd::setSwapAudioChannels(const bool swapAudioChannels) {
   mAudioFile.setSwapChannels(swapAudioChannels);
+  updatePlaybackRouting();
 }
 
 QString BackEnd::songArtist() { return mSongArtist; }
@@ -94,6 +146,10 @@ PrimitiveList* BackEnd::ledPrimitives(void) { return mLedPrimitives; }
 
 AudioPlayer* BackEnd::audioPlayer(void) { return mAudioPlayer; }
 
+WaveformPeaks* BackEnd::waveformPeaks(void) { return mWaveformPeaks; }
+
+BeatModel* BackEnd::beats(void) { return mBeatModel; }
+
 void BackEnd::setSongArtist(const QString& name) {
   if (name == mSongArtist) return;
 
@@ -121,6 +177,13 @@ Q_INVOKABLE void BackEnd::loadMP3(const QString& filePath) {
   // stop audio playback:
   mAudioPlayer->stop();
 
+  // and discard data signal converter, waveform and beats of previous song
+  mGeneratePool.waitForDone();
+  mPrimitiveConverter.reset();
+  mWaveformPeaks->clear();
+  mBeatModel->clear();
+  mBeatIndex.clear();
+
   mLoadFuture = QtConcurrent::run(this, &BackEnd::loadMP3Worker,
                                   localFilePath.toLocalFile());
   mLoadFutureWatcher.setFuture(mLoadFuture);
@@ -129,20 +192,48 @@ Q_INVOKABLE void BackEnd::loadMP3(const QString& filePath) {
 Q_INVOKABLE void BackEnd::saveMP3(const QString& filePath) {
   // convert to qurl and localized file path:
   QUrl localFilePath{filePath};
+  // take the beats to re-render here, as edits during saving extend the range
+  // again from the main thread:
+  collectDirtyBeats();
+  const int renderStartBeat = mRenderStartBeat;
+  const int renderEndBeat = mRenderEndBeat;
+  mRenderStartBeat = 0;
+  mRenderEndBeat = 0;
   mSaveFuture = QtConcurrent::run(this, &BackEnd::saveMP3Worker,
-                                  localFilePath.toLocalFile());
+                                  localFilePath.toLocalFile(), renderStartBeat,
+                                  renderEndBeat);
   mSaveFutureWatcher.setFuture(mSaveFuture);
 }
 
 void BackEnd::handleDoneLoading(void) {
-  emit doneLoading(mLoadFuture.result());
+  const bool result = mLoadFuture.result();
+  if (result) {
+    mBeatModel->setFrames(mBeatFrames);
+    mBeatIndex.build(mBeatFrames);
+    const int nBeats = static_cast<int>(mBeatFrames.size());
+    mMotorPrimitives->setNumBeats(nBeats);
+    mLedPrimitives->setNumBeats(nBeats);
+  }
+  emit doneLoading(result);
   emit mp3LoadedChanged();
   // read out primitives if it is a dancefile:
   // need to do that in main thread (here) as we are assigning the parent
-  if (mAudioFile.isDancefile()) {
+  if (result && mAudioFile.isDancefile()) {
     readPrimitivesFromPrependData();
   }
 
+  if (result) {
+    // create converter for new beats and generate all commands, which are
+    // rendered to the audio file data signal on saving
+    mMotorPrimitives->clearDirtyRange();
+    mLedPrimitives->clearDirtyRange();
+    mPrimitiveConverter =
+        std::make_unique<PrimitiveToSignal>(mBeatFrames, &mAudioFile);
+    mRenderStartBeat = 0;
+    mRenderEndBeat = static_cast<int>(mBeatFrames.size() - 1);
+    updateCommands(mRenderStartBeat, mRenderEndBeat);
+  }
+
   // setup audio player:
   mAudioPlayer->resetAudioOutput();
   mAudioPlayer->setAudioData(mAudioFile.mFloatMusic, mAudioFile.mFloatMusic);
@@ -243,16 +334,26 @@ bool BackEnd::loadMP3Worker(const QString& filePath) {
   }
   mAverageBeatFrames = static_cast<int>(sum / (mBeatFrames.size() - 3u));
 
+  mFileStatus = "Preparing waveform...";
+  emit fileStatusChanged();
+  mWaveformPeaks->build(&mAudioFile.mFloatMusic);
+
   mFileStatus = "Done.";
   emit fileStatusChanged();
   return true;
 }
 
-bool BackEnd::saveMP3Worker(const QString& fileName) {
+bool BackEnd::saveMP3Worker(const QString& fileName, const int renderStartBeat,
+                            const int renderEndBeat) {
   mFileStatus = "Preparing beats, moves, and lights for saving...";
   QThread::msleep(250);
   emit fileStatusChanged();
 
+  // update data signal first, such that the range is rendered even if saving
+  // fails. The commands of all edits so far are queued already.
+  mGeneratePool.waitForDone();
+  renderDataSignal(renderStartBeat, renderEndBeat);
+
   // write prepend data:
   if (!writePrependData()) {
     mFileStatus = "ERROR: Save data preparation failed. Sorry :(";
@@ -261,11 +362,6 @@ bool BackEnd::saveMP3Worker(const QString& fileName) {
     return false;
   }
 
-  // instantiate primitive to audio signal converter
-  PrimitiveToSignal primitiveConverter(mBeatFrames, &mAudioFile);
-  primitiveConverter.convert(mMotorPrimitives->getData(),
-                             mLedPrimitives->getData());
-
   mFileStatus = "Saving to MP3 File";
   emit fileStatusChanged();
   // save file
@@ -304,8 +400,6 @@ bool BackEnd::saveMP3Worker(const QString& fileName) {
   return true;
 }
 
-std::vector<int> BackEnd::getBeats(void) const { return mBeatFrames; }
-
 int BackEnd::getAudioLengthInFrames(void) const {
   return static_cast<int>(mAudioFile.getLengthInFrames());
 }
@@ -323,64 +417,127 @@ void BackEnd::printLedPrimitives(void) const {
 }
 
 void BackEnd::setPlayBackForRobots(void) {
-  mFileStatus =
-      "Compiling moves and lights and setting output sound for Dancebots...";
-  emit fileStatusChanged();
-  mAudioPlayerTime = mAudioPlayer->getCurrentPlaybackTime();
-
-  // stop audio playback:
-  mAudioPlayer->stop(false);
-  mAudioPlayer->resetAudioOutput();
-  qApp->processEvents();
-
-  mSoundSetFuture =
-      QtConcurrent::run(this, &BackEnd::setPlayBackForRobotsWorker);
-  mSoundSetFutureWatcher.setFuture(mSoundSetFuture);
+  mRobotPlayback = true;
+  updatePlaybackRouting();
+  emit doneSettingSound();
 }
 
 void BackEnd::setPlayBackForHumans(void) {
-  mFileStatus = "Setting output sound for humans...";
-  emit fileStatusChanged();
-  mAudioPlayerTime = mAudioPlayer->getCurrentPlaybackTime();
-  // stop audio playback:
-  mAudioPlayer->stop(false);
-  mAudioPlayer->resetAudioOutput();
-  qApp->processEvents();
+  mRobotPlayback = false;
+  updatePlaybackRouting();
+  emit doneSettingSound();
+}
 
-  mSoundSetFuture =
-      QtConcurrent::run(this, &BackEnd::setPlayBackForHumansWorker);
-  mSoundSetFutureWatcher.setFuture(mSoundSetFuture);
+void BackEnd::updatePlaybackRouting(void) {
+  if (!mRobotPlayback) {
+    mAudioPlayer->clearDataSource();
+    return;
+  }
+  // the data signal is synthesized from the current commands for every block
+  // played back, so primitive changes are audible immediately:
+  mAudioPlayer->setDataSource(
+      [this](const size_t startFrame, const size_t nFrames, float* signal) {
+        if (mPrimitiveConverter) {
+          mPrimitiveConverter->synthesizeFrames(startFrame, nFrames, signal);
+        } else {
+          std::fill(signal, signal + nFrames, 0.0f);
+        }
+      },
+      mAudioFile.getSwapChannels() ? 0 : 1);
 }
 
-void BackEnd::setPlayBackForHumansWorker(void) {
-  mAudioPlayer->setAudioData(mAudioFile.mFloatMusic, mAudioFile.mFloatMusic);
+void BackEnd::scheduleCollectDirtyBeats(void) {
+  // a single edit may emit several property notifications, so only collect
+  // once per event loop pass:
+  if (mCollectPending) {
+    return;
+  }
+  mCollectPending = true;
+  QTimer::singleShot(0, this, [this]() {
+    mCollectPending = false;
+    collectDirtyBeats();
+  });
 }
 
-void BackEnd::setPlayBackForRobotsWorker(void) {
-  // instantiate primitive to audio signal converter
-  PrimitiveToSignal primitiveConverter(mBeatFrames, &mAudioFile);
-  primitiveConverter.convert(mMotorPrimitives->getData(),
-                             mLedPrimitives->getData());
-  if (mAudioFile.getSwapChannels()) {
-    mAudioPlayer->setAudioData(mAudioFile.mFloatData, mAudioFile.mFloatMusic);
-  } else {
-    mAudioPlayer->setAudioData(mAudioFile.mFloatMusic, mAudioFile.mFloatData);
+void BackEnd::collectDirtyBeats(void) {
+  if (!mPrimitiveConverter) {
+    return;
+  }
+  int motorStart = 0;
+  int motorEnd = 0;
+  int ledStart = 0;
+  int ledEnd = 0;
+  const bool motorDirty =
+      mMotorPrimitives->getDirtyRange(&motorStart, &motorEnd);
+  const bool ledDirty = mLedPrimitives->getDirtyRange(&ledStart, &ledEnd);
+  mMotorPrimitives->clearDirtyRange();
+  mLedPrimitives->clearDirtyRange();
+
+  // accumulate, as the previous range may not have been rendered yet
+  if (motorDirty) {
+    mRenderStartBeat = mRenderStartBeat < mRenderEndBeat
+                           ? std::min(mRenderStartBeat, motorStart)
+                           : motorStart;
+    mRenderEndBeat = std::max(mRenderEndBeat, motorEnd);
+  }
+  if (ledDirty) {
+    mRenderStartBeat = mRenderStartBeat < mRenderEndBeat
+                           ? std::min(mRenderStartBeat, ledStart)
+                           : ledStart;
+    mRenderEndBeat = std::max(mRenderEndBeat, ledEnd);
+  }
+
+  // and update the commands of the changed beats right away:
+  if (motorDirty || ledDirty) {
+    const int startBeat = std::min(motorDirty ? motorStart : ledStart,
+                                   ledDirty ? ledStart : motorStart);
+    const int endBeat = std::max(motorDirty ? motorEnd : ledEnd,
+                                 ledDirty ? ledEnd : motorEnd);
+    updateCommands(startBeat, endBeat);
   }
 }
 
-void BackEnd::handleDoneSettingSound(void) {
-  mAudioPlayer->seek(mAudioPlayerTime);
-  emit mAudioPlayer->notify(mAudioPlayerTime);
-  emit doneSettingSound();
+void BackEnd::updateCommands(const int startBeat, const int endBeat) {
+  const size_t start = static_cast<size_t>(std::max(startBeat, 0));
+  const size_t end = static_cast<size_t>(std::max(endBeat, 0));
+  if (mPendingGenerations == 0 && endBeat - startBeat <= maxSyncGenerateBeats) {
+    mPrimitiveConverter->generateCommands(mMotorPrimitives->getSortedData(),
+                                          mLedPrimitives->getSortedData(),
+                                          start, end);
+    return;
+  }
+
+  // larger ranges, e.g. after loading or moving many primitives, would stall
+  // the GUI and playback. Queue them, and ranges following them to keep the
+  // order, with copies of the primitives:
+  ++mPendingGenerations;
+  PrimitiveToSignal* const converter = mPrimitiveConverter.get();
+  const QList<QObject*> motorPrimitives =
+      copyMotorPrimitives(mMotorPrimitives->getSortedData());
+  const QList<QObject*> ledPrimitives =
+      copyLedPrimitives(mLedPrimitives->getSortedData());
+  QtConcurrent::run(&mGeneratePool, [=]() {
+    converter->generateCommands(motorPrimitives, ledPrimitives, start, end);
+    qDeleteAll(motorPrimitives);
+    qDeleteAll(ledPrimitives);
+    QMetaObject::invokeMethod(
+        this, [this]() { --mPendingGenerations; }, Qt::QueuedConnection);
+  });
+}
+
+void BackEnd::renderDataSignal(const int startBeat, const int endBeat) {
+  if (!mPrimitiveConverter) {
+    return;
+  }
+  // commands are up to date, so only the signal has to be written
+  mPrimitiveConverter->synthesize(static_cast<size_t>(std::max(startBeat, 0)),
+                                  static_cast<size_t>(std::max(endBeat, 0)));
 }
 
 int BackEnd::getBeatAtFrame(const int frame) const {
-  // run utility function to find beat
+  // use the lookup index, which takes constant time on average
   size_t ind = 0;
-  // use binary search, as it is much faster for larger arrays
-  // and about the same speed as linear search for smaller ones
-  int rv = utils::findInterval<int>(frame, mBeatFrames, &ind,
-                                    utils::SearchMethod::Binary);
+  int rv = mBeatIndex.findInterval(frame, &ind);
 
   // return -1 if search failed
   if (rv < 0) {
@@ -391,6 +548,25 @@ int BackEnd::getBeatAtFrame(const int frame) const {
   return static_cast<int>(ind);
 }
 
+QVector<int> BackEnd::getBeatsAtFrames(const QVector<int>& frames) const {
+  QVector<int> beats(frames.size());
+  mBeatIndex.findIntervals(frames.constData(),
+                           static_cast<size_t>(frames.size()), beats.data());
+  return beats;
+}
+
+void BackEnd::setLoopBeats(const int startBeat, const int endBeat) {
+  const int nBeats = static_cast<int>(mBeatFrames.size());
+  if (startBeat < 0 || startBeat >= nBeats || endBeat <= startBeat) {
+    return;
+  }
+  const int endFrame =
+      endBeat < nBeats ? mBeatFrames[endBeat] : getAudioLengthInFrames();
+  mAudioPlayer->setLoopFrames(mBeatFrames[startBeat], endFrame);
+}
+
+void BackEnd::clearLoop(void) { mAudioPlayer->clearLoop(); }
+
 bool BackEnd::writePrependData(void) {
   // clear prepend data:
   mAudioFile.mMP3PrependData.clear();
@@ -436,6 +612,12 @@ bool BackEnd::serializeBeatsAndPrimitives(QDataStream* const stream) {
     const LEDPrimitive* const lp = reinterpret_cast<const LEDPrimitive*>(e);
     lp->serializeToStream(stream);
   }
+
+  // finally, write out random led seeds, in the same order as the primitives:
+  for (const auto& e : ledPrimitives) {
+    const LEDPrimitive* const lp = reinterpret_cast<const LEDPrimitive*>(e);
+    lp->serializeSeedToStream(stream);
+  }
   return true;
 }
 
@@ -484,8 +666,20 @@ bool BackEnd::readPrimitivesFromPrependData(void) {
   quint32 nLedPrimitives = 0;
   dataStream >> nLedPrimitives;
 
+  std::vector<LEDPrimitive*> ledPrimitives;
   for (size_t i = 0; i < nLedPrimitives; ++i) {
-    LEDPrimitive* lp = new LEDPrimitive(&dataStream, nullptr);
+    ledPrimitives.push_back(new LEDPrimitive(&dataStream, nullptr));
+  }
+
+  // read out random led seeds, which are missing in files of older versions.
+  // In this case, the primitives keep their randomly initialized seeds:
+  if (!dataStream.atEnd()) {
+    for (LEDPrimitive* const lp : ledPrimitives) {
+      lp->readSeedFromStream(&dataStream);
+    }
+  }
+
+  for (LEDPrimitive* const lp : ledPrimitives) {
     mLedPrimitives->add(lp);
   }
 
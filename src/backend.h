@@ -24,13 +24,20 @@
 #include <QFutureWatcher>
 #include <QObject>
 #include <QString>
+#include <QThreadPool>
+#include <QVector>
 
+#include <memory>
 #include <vector>
 
 #include "src/audio_file.h"
 #include "src/audio_player.h"
 #include "src/beat_detector.h"
+#include "src/beat_model.h"
 #include "src/primitive_list.h"
+#include "src/primitive_to_signal.h"
+#include "src/utils.h"
+#include "src/waveform_peaks.h"
 
 /** \class BackEnd
  * \brief Backend class providing primitive models and audio data handling and
@@ -54,6 +61,8 @@ class BackEnd : public QObject {
   Q_PROPERTY(
       AudioPlayer* audioPlayer READ audioPlayer NOTIFY audioPlayerChanged);
   Q_PROPERTY(bool mp3Loaded READ mp3Loaded NOTIFY mp3LoadedChanged);
+  Q_PROPERTY(WaveformPeaks* waveformPeaks READ waveformPeaks CONSTANT);
+  Q_PROPERTY(BeatModel* beats READ beats CONSTANT);
 
  public:
   explicit BackEnd(QObject* parent = nullptr);
@@ -105,6 +114,16 @@ class BackEnd : public QObject {
    */
   AudioPlayer* audioPlayer(void);
 
+  /**
+   * \brief Get waveform summary of the loaded song's music
+   */
+  WaveformPeaks* waveformPeaks(void);
+
+  /**
+   * \brief Get beat locations of the loaded song
+   */
+  BeatModel* beats(void);
+
   /**
    * \brief Set ID3-Tag song artist string
    */
@@ -153,11 +172,6 @@ class BackEnd : public QObject {
    */
   Q_INVOKABLE void saveMP3(const QString& filePath);
 
-  /**
-   * \brief Get vector of beat locations in audio frames
-   */
-  Q_INVOKABLE std::vector<int> getBeats(void) const;
-
   /**
    * \brief Get total audio length in frames
    */
@@ -183,6 +197,28 @@ class BackEnd : public QObject {
    */
   Q_INVOKABLE int getBeatAtFrame(const int frame) const;
 
+  /**
+   * \brief Find the beats at many audio frames at once, see getBeatAtFrame
+   *
+   * \return beat index per frame, or -1 where no valid interval can be found
+   */
+  Q_INVOKABLE QVector<int> getBeatsAtFrames(const QVector<int>& frames) const;
+
+  /**
+   * \brief Loop playback over the beats [startBeat, endBeat). The loop
+   * starts and ends at the beat frames, and an end beat past the last beat
+   * loops to the end of the song.
+   *
+   * \param[in] startBeat - first beat of the loop
+   * \param[in] endBeat - beat after the last beat of the loop
+   */
+  Q_INVOKABLE void setLoopBeats(const int startBeat, const int endBeat);
+
+  /**
+   * \brief Stop looping playback
+   */
+  Q_INVOKABLE void clearLoop(void);
+
   /**
    * \brief Set time in MS that error messages are shown during loading/saving.
    * Negative times are ignored.
@@ -214,7 +250,6 @@ class BackEnd : public QObject {
  public slots:
   void handleDoneLoading(void);
   void handleDoneSaving(void);
-  void handleDoneSettingSound(void);
   void printMotPrimitives(void) const;
   void printLedPrimitives(void) const;
   void setPlayBackForRobots(void);
@@ -237,27 +272,91 @@ class BackEnd : public QObject {
   QString mFileStatus;
   AudioFile mAudioFile;
   AudioPlayer* mAudioPlayer;
-  int mAudioPlayerTime = 0;
+  bool mRobotPlayback{false};  // data signal played back instead of music
   BeatDetector mBeatDetector;
   std::vector<int> mBeatFrames; /**< beat locations in audio frames */
+  // lookup of beats at frames, built in the main thread after loading
+  utils::IntervalIndex<int> mBeatIndex;
 
   // multi-threading members for loading and saving in separate threads
   // to keep UI responsive / showing messages during loading and saving
   QFuture<bool> mLoadFuture;
   QFutureWatcher<bool> mLoadFutureWatcher;
-  QFuture<void> mSoundSetFuture;
-  QFutureWatcher<void> mSoundSetFutureWatcher;
   QFuture<bool> mSaveFuture;
   QFutureWatcher<bool> mSaveFutureWatcher;
-  void setPlayBackForRobotsWorker(void);
-  void setPlayBackForHumansWorker(void);
   bool loadMP3Worker(const QString& fileName);
-  bool saveMP3Worker(const QString& fileName);
+  bool saveMP3Worker(const QString& fileName, const int renderStartBeat,
+                     const int renderEndBeat);
 
   // data models for motor and led primitives
   PrimitiveList* mMotorPrimitives;  // raw pointer fine because it is QObject
   PrimitiveList* mLedPrimitives;    // raw pointer fine because it is QObject
 
+  // waveform of the music, built after loading
+  WaveformPeaks* mWaveformPeaks;  // raw pointer fine because it is QObject
+
+  // beats of the loaded song for the UI, set in the main thread after loading
+  BeatModel* mBeatModel;  // raw pointer fine because it is QObject
+
+  // primitive to data signal converter of the loaded song. Its commands are
+  // kept up to date with the primitives, such that the data signal can be
+  // synthesized on the fly for playback
+  std::unique_ptr<PrimitiveToSignal> mPrimitiveConverter;
+  // beat range [start, end) of the data signal in the audio file to re-render
+  int mRenderStartBeat{0};
+  int mRenderEndBeat{0};
+
+  // commands of beat ranges up to this size are generated in the main thread
+  // right away, larger ones on mGeneratePool
+  static const int maxSyncGenerateBeats{64};
+  // single thread generating commands of large beat ranges, such that the
+  // ranges are generated in the order of the edits. Declared after the
+  // converter to be destroyed, i.e. finished, first.
+  QThreadPool mGeneratePool;
+  // number of generations queued on mGeneratePool
+  int mPendingGenerations{0};
+
+  // whether collectDirtyBeats is scheduled for the next event loop pass
+  bool mCollectPending{false};
+
+  /**
+   * \brief Regenerate commands of the beats affected by primitive changes,
+   * reset the primitive models' dirty ranges, and collect the beats to
+   * re-render in the audio file data signal. Called from the main thread.
+   */
+  void collectDirtyBeats(void);
+
+  /**
+   * \brief Regenerate commands of a beat range, in the main thread if the
+   * range is small and no other generation is queued, and otherwise from
+   * copies of the primitives on mGeneratePool
+   *
+   * \param[in] startBeat - first beat to regenerate
+   * \param[in] endBeat - one beyond the last beat to regenerate
+   */
+  void updateCommands(const int startBeat, const int endBeat);
+
+  /**
+   * \brief Schedule collectDirtyBeats for the next event loop pass, unless it
+   * is already scheduled. Called whenever primitives change.
+   */
+  void scheduleCollectDirtyBeats(void);
+
+  /**
+   * \brief Render data signal for a range of beats collected by
+   * collectDirtyBeats
+   *
+   * \param[in] startBeat - first beat to render
+   * \param[in] endBeat - one beyond the last beat to render
+   */
+  void renderDataSignal(const int startBeat, const int endBeat);
+
+  /**
+   * \brief Route synthesized data signal or music to the player's data
+   * channel, depending on mRobotPlayback and channel swapping
+   */
+  void updatePlaybackRouting(void);
+
   /**
    * \brief Write beats and primitives to MP3 prepend data
    */
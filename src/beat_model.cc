@@ -0,0 +1,83 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/beat_model.h"
+
+#include <algorithm>
+
+BeatModel::BeatModel(QObject* parent) : QAbstractListModel{parent} {}
+
+int BeatModel::rowCount(const QModelIndex& parent) const {
+  Q_UNUSED(parent);
+  return count();
+}
+
+QVariant BeatModel::data(const QModelIndex& index, int role) const {
+  if (Qt::UserRole + 1 == role && index.row() >= 0 &&
+      index.row() < count()) {
+    return QVariant(mFrames[index.row()]);
+  } else {
+    return QVariant();
+  }
+}
+
+QHash<int, QByteArray> BeatModel::roleNames() const {
+  QHash<int, QByteArray> roles;
+  roles[Qt::UserRole + 1] = "frame";
+  return roles;
+}
+
+int BeatModel::count(void) const { return static_cast<int>(mFrames.size()); }
+
+int BeatModel::getFrame(const int beat) const {
+  if (beat < 0 || beat >= count()) {
+    return -1;
+  }
+  return mFrames[beat];
+}
+
+int BeatModel::getFirstBeatFrom(const qreal frame) const {
+  return static_cast<int>(
+      std::lower_bound(mFrames.begin(), mFrames.end(), frame) -
+      mFrames.begin());
+}
+
+std::pair<int, int> BeatModel::getBeatRange(const qreal startFrame,
+                                            const qreal endFrame) const {
+  const auto first = std::lower_bound(mFrames.begin(), mFrames.end(),
+                                      startFrame);
+  const auto last = std::upper_bound(first, mFrames.end(), endFrame);
+  return {static_cast<int>(first - mFrames.begin()),
+          static_cast<int>(last - mFrames.begin())};
+}
+
+const std::vector<int>& BeatModel::getFrames(void) const { return mFrames; }
+
+void BeatModel::setFrames(const std::vector<int>& frames) {
+  const bool countChange = frames.size() != mFrames.size();
+  beginResetModel();
+  mFrames = frames;
+  endResetModel();
+  if (countChange) {
+    emit countChanged();
+  }
+  emit framesChanged();
+}
+
+void BeatModel::clear(void) { setFrames(std::vector<int>{}); }
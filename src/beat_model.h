@@ -0,0 +1,114 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_BEAT_MODEL_H_
+#define SRC_BEAT_MODEL_H_
+
+#include <QAbstractListModel>
+#include <QHash>
+
+#include <utility>
+#include <vector>
+
+/** \class BeatModel
+ * \brief Read-only model of the beat locations of the loaded song in audio
+ * frames. See documentation of QAbstractListModel for more information about
+ * overridden functions.
+ *
+ * QML accesses single beats through getFrame instead of holding a copy of all
+ * beats, and C++ items query the beats within a frame window directly. The
+ * beats are only set from the main thread.
+ */
+class BeatModel : public QAbstractListModel {
+  Q_OBJECT;
+
+  Q_PROPERTY(int count READ count NOTIFY countChanged);
+
+ public:
+  explicit BeatModel(QObject* parent = nullptr);
+
+  /**
+   * \brief Get number of beats
+   */
+  int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+
+  /**
+   * \brief Get beat frame at given index. The frame is stored at role
+   * Qt::UserRole + 1
+   */
+  QVariant data(const QModelIndex& index, int role) const override;
+
+  /**
+   * \brief Get number of beats
+   */
+  int count(void) const;
+
+  /**
+   * \brief Get audio frame of a beat
+   *
+   * \return beat frame, or -1 if the beat index is out of range
+   */
+  Q_INVOKABLE int getFrame(const int beat) const;
+
+  /**
+   * \brief Get index of the first beat at or after a frame
+   *
+   * \return beat index, which is count if there is no such beat
+   */
+  Q_INVOKABLE int getFirstBeatFrom(const qreal frame) const;
+
+  /**
+   * \brief Get the beats within a frame window
+   *
+   * \param[in] startFrame - first frame of the window
+   * \param[in] endFrame - last frame of the window
+   * \return beat index range [first, last) of the beats with
+   * startFrame <= frame <= endFrame
+   */
+  std::pair<int, int> getBeatRange(const qreal startFrame,
+                                   const qreal endFrame) const;
+
+  /**
+   * \brief Get reference to all beat frames
+   */
+  const std::vector<int>& getFrames(void) const;
+
+  /**
+   * \brief Replace all beats, resetting the model
+   */
+  void setFrames(const std::vector<int>& frames);
+
+  /**
+   * \brief Remove all beats, resetting the model
+   */
+  void clear(void);
+
+  // NOLINTNEXTLINE
+ signals:
+  void countChanged(void);
+  void framesChanged(void);
+
+ protected:
+  QHash<int, QByteArray> roleNames() const override;
+
+ private:
+  std::vector<int> mFrames;
+};
+
+#endif  // SRC_BEAT_MODEL_H_
@@ -0,0 +1,267 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/beat_occupancy.h"
+
+#include <algorithm>
+#include <iterator>
+
+void BeatOccupancy::setNumBeats(const int numBeats) {
+  mNumBeats = numBeats;
+  buildTree();
+}
+
+int BeatOccupancy::getNumBeats(void) const { return mNumBeats; }
+
+void BeatOccupancy::occupy(const int startBeat, const int endBeat) {
+  if (startBeat >= endBeat) {
+    return;
+  }
+  mRanges.emplace(startBeat, endBeat);
+  if (getLimit() > 0) {
+    addCover(1, 0, getLimit(), startBeat, endBeat, 1);
+  }
+}
+
+void BeatOccupancy::free(const int startBeat, const int endBeat) {
+  const auto range = mRanges.equal_range(startBeat);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (it->second == endBeat) {
+      mRanges.erase(it);
+      if (getLimit() > 0) {
+        addCover(1, 0, getLimit(), startBeat, endBeat, -1);
+      }
+      return;
+    }
+  }
+}
+
+void BeatOccupancy::clear(void) {
+  mRanges.clear();
+  buildTree();
+}
+
+bool BeatOccupancy::isFree(const int startBeat, const int endBeat) const {
+  if (startBeat < 0 || endBeat > getLimit() || startBeat >= endBeat) {
+    return false;
+  }
+  // the range before the start must end before it, and the next range must
+  // start at the end or later:
+  const auto next = mRanges.upper_bound(startBeat);
+  if (next != mRanges.begin() && std::prev(next)->second > startBeat) {
+    return false;
+  }
+  return next == mRanges.end() || next->first >= endBeat;
+}
+
+int BeatOccupancy::getFreeLength(const int startBeat,
+                                 const int maxLength) const {
+  if (startBeat < 0 || startBeat >= getLimit() || maxLength <= 0) {
+    return 0;
+  }
+  const auto next = mRanges.upper_bound(startBeat);
+  if (next != mRanges.begin() && std::prev(next)->second > startBeat) {
+    return 0;
+  }
+  int endBeat = std::min(startBeat + maxLength, getLimit());
+  if (next != mRanges.end()) {
+    endBeat = std::min(endBeat, next->first);
+  }
+  return endBeat - startBeat;
+}
+
+int BeatOccupancy::getNearestFreeStart(const int beat,
+                                       const int length) const {
+  const int limit = getLimit();
+  if (length <= 0 || length > limit) {
+    return -1;
+  }
+  const int clampedBeat = std::max(0, std::min(beat, limit - length));
+
+  // first fit starting at or after the beat, and last fit starting at or
+  // before it, i.e. ending at or before the beat's end:
+  int run = 0;
+  const int right = findFirstFree(1, 0, limit, clampedBeat, length, &run);
+  run = 0;
+  const int left =
+      findLastFree(1, 0, limit, clampedBeat + length, length, &run);
+
+  if (left < 0) {
+    return right;
+  }
+  if (right < 0) {
+    return left;
+  }
+  return clampedBeat - left <= right - clampedBeat ? left : right;
+}
+
+void BeatOccupancy::buildTree(void) {
+  const int limit = getLimit();
+  if (limit <= 0) {
+    mTree.clear();
+    return;
+  }
+  mTree.assign(4 * static_cast<size_t>(limit), Node{});
+  // all beats free, then occupy the ranges again:
+  buildNode(1, 0, limit);
+  for (const auto& range : mRanges) {
+    addCover(1, 0, limit, range.first, range.second, 1);
+  }
+}
+
+void BeatOccupancy::buildNode(const int node, const int lo, const int hi) {
+  if (hi - lo > 1) {
+    const int mid = lo + (hi - lo) / 2;
+    buildNode(2 * node, lo, mid);
+    buildNode(2 * node + 1, mid, hi);
+  }
+  pull(node, lo, hi);
+}
+
+void BeatOccupancy::addCover(const int node, const int lo, const int hi,
+                             const int startBeat, const int endBeat,
+                             const int delta) {
+  if (endBeat <= lo || hi <= startBeat) {
+    return;
+  }
+  if (startBeat <= lo && hi <= endBeat) {
+    mTree[node].cover += delta;
+  } else {
+    const int mid = lo + (hi - lo) / 2;
+    addCover(2 * node, lo, mid, startBeat, endBeat, delta);
+    addCover(2 * node + 1, mid, hi, startBeat, endBeat, delta);
+  }
+  pull(node, lo, hi);
+}
+
+void BeatOccupancy::pull(const int node, const int lo, const int hi) {
+  Node& n = mTree[node];
+  if (n.cover > 0) {
+    n.prefix = n.suffix = n.best = 0;
+    return;
+  }
+  if (hi - lo == 1) {
+    n.prefix = n.suffix = n.best = 1;
+    return;
+  }
+  const int mid = lo + (hi - lo) / 2;
+  const Node& left = mTree[2 * node];
+  const Node& right = mTree[2 * node + 1];
+  n.prefix = left.prefix == mid - lo ? left.prefix + right.prefix
+                                     : left.prefix;
+  n.suffix = right.suffix == hi - mid ? right.suffix + left.suffix
+                                      : right.suffix;
+  n.best = std::max(std::max(left.best, right.best),
+                    left.suffix + right.prefix);
+}
+
+int BeatOccupancy::findFirstFree(const int node, const int lo, const int hi,
+                                 const int fromBeat, const int length,
+                                 int* run) const {
+  if (hi <= fromBeat) {
+    return -1;
+  }
+  const Node& n = mTree[node];
+  if (fromBeat <= lo) {
+    // the subtree is entirely after fromBeat, so either the run reaches into
+    // it far enough, or the fit lies within it, or the run continues:
+    if (*run + n.prefix >= length) {
+      return lo - *run;
+    }
+    if (n.best < length) {
+      *run = n.prefix == hi - lo ? *run + n.prefix : n.suffix;
+      return -1;
+    }
+    int first = node;
+    int firstLo = lo;
+    int firstHi = hi;
+    while (firstHi - firstLo > 1) {
+      const int mid = firstLo + (firstHi - firstLo) / 2;
+      const Node& left = mTree[2 * first];
+      const Node& right = mTree[2 * first + 1];
+      if (left.best >= length) {
+        first = 2 * first;
+        firstHi = mid;
+      } else if (left.suffix + right.prefix >= length) {
+        return mid - left.suffix;
+      } else {
+        first = 2 * first + 1;
+        firstLo = mid;
+      }
+    }
+    return firstLo;
+  }
+  if (n.cover > 0) {
+    *run = 0;
+    return -1;
+  }
+  const int mid = lo + (hi - lo) / 2;
+  const int first = findFirstFree(2 * node, lo, mid, fromBeat, length, run);
+  if (first >= 0) {
+    return first;
+  }
+  return findFirstFree(2 * node + 1, mid, hi, fromBeat, length, run);
+}
+
+int BeatOccupancy::findLastFree(const int node, const int lo, const int hi,
+                                const int toBeat, const int length,
+                                int* run) const {
+  if (toBeat <= lo) {
+    return -1;
+  }
+  const Node& n = mTree[node];
+  if (hi <= toBeat) {
+    // mirrored findFirstFree, from the end of the subtree:
+    if (*run + n.suffix >= length) {
+      return hi + *run - length;
+    }
+    if (n.best < length) {
+      *run = n.suffix == hi - lo ? *run + n.suffix : n.prefix;
+      return -1;
+    }
+    int last = node;
+    int lastLo = lo;
+    int lastHi = hi;
+    while (lastHi - lastLo > 1) {
+      const int mid = lastLo + (lastHi - lastLo) / 2;
+      const Node& left = mTree[2 * last];
+      const Node& right = mTree[2 * last + 1];
+      if (right.best >= length) {
+        last = 2 * last + 1;
+        lastLo = mid;
+      } else if (left.suffix + right.prefix >= length) {
+        return mid + right.prefix - length;
+      } else {
+        last = 2 * last;
+        lastHi = mid;
+      }
+    }
+    return lastLo;
+  }
+  if (n.cover > 0) {
+    *run = 0;
+    return -1;
+  }
+  const int mid = lo + (hi - lo) / 2;
+  const int last = findLastFree(2 * node + 1, mid, hi, toBeat, length, run);
+  if (last >= 0) {
+    return last;
+  }
+  return findLastFree(2 * node, lo, mid, toBeat, length, run);
+}
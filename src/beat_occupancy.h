@@ -0,0 +1,154 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_BEAT_OCCUPANCY_H_
+#define SRC_BEAT_OCCUPANCY_H_
+
+#include <map>
+#include <vector>
+
+/** \class BeatOccupancy
+ * \brief Index of the beat ranges occupied by the primitives of a track, with
+ * logarithmic time queries for free space.
+ *
+ * Ranges are half-open beat intervals [start, end) and have to lie within
+ * [0, numBeats - 1], i.e. a primitive ends at the last beat at the latest.
+ * Occupied ranges are assumed not to overlap, as primitives of a track never
+ * do.
+ *
+ * Besides the ranges by start beat, a segment tree over the beats keeps how
+ * often each beat is covered and the longest free runs, such that the
+ * nearest free range of any length is found in O(log numBeats) as well.
+ */
+class BeatOccupancy {
+ public:
+  /**
+   * \brief Set the number of beats of the song, which limits all ranges
+   */
+  void setNumBeats(const int numBeats);
+
+  /**
+   * \brief Get the number of beats of the song
+   */
+  int getNumBeats(void) const;
+
+  /**
+   * \brief Mark a beat range occupied
+   */
+  void occupy(const int startBeat, const int endBeat);
+
+  /**
+   * \brief Free a beat range previously passed to occupy
+   */
+  void free(const int startBeat, const int endBeat);
+
+  /**
+   * \brief Free all beats
+   */
+  void clear(void);
+
+  /**
+   * \brief Check if a beat range is within the song and not occupied
+   */
+  bool isFree(const int startBeat, const int endBeat) const;
+
+  /**
+   * \brief Get the number of free beats starting at a beat, i.e. the length a
+   * primitive placed there can extend to
+   *
+   * \param[in] startBeat - first beat
+   * \param[in] maxLength - maximum length to return
+   * \return number of free beats up to maxLength, 0 if the start beat is
+   * occupied or outside the song
+   */
+  int getFreeLength(const int startBeat, const int maxLength) const;
+
+  /**
+   * \brief Get the free start beat nearest to a beat that fits a range of the
+   * given length, in O(log numBeats)
+   *
+   * \return start beat, or -1 if no free range of that length exists
+   */
+  int getNearestFreeStart(const int beat, const int length) const;
+
+ private:
+  // segment tree node of a beat range
+  struct Node {
+    int cover{0};   /**< number of ranges covering the whole node */
+    int prefix{0};  /**< free beats at the start */
+    int suffix{0};  /**< free beats at the end */
+    int best{0};    /**< longest free run */
+  };
+
+  int mNumBeats{0};
+  std::multimap<int, int> mRanges;  /**< start beat to end beat */
+  std::vector<Node> mTree;  /**< root at 1, over beats [0, getLimit()) */
+
+  /**
+   * \brief Get the last beat ranges can end at
+   */
+  int getLimit(void) const { return mNumBeats - 1; }
+
+  /**
+   * \brief Rebuild the segment tree from mRanges
+   */
+  void buildTree(void);
+
+  /**
+   * \brief Initialize the subtree of node, which covers the beats [lo, hi),
+   * to free beats
+   */
+  void buildNode(const int node, const int lo, const int hi);
+
+  /**
+   * \brief Add delta to the cover of the beats [startBeat, endBeat) in the
+   * subtree of node, which covers the beats [lo, hi)
+   */
+  void addCover(const int node, const int lo, const int hi,
+                const int startBeat, const int endBeat, const int delta);
+
+  /**
+   * \brief Update the free runs of node from its cover and children
+   */
+  void pull(const int node, const int lo, const int hi);
+
+  /**
+   * \brief Find the first start beat at or after fromBeat of a free range of
+   * the given length, in the subtree of node covering the beats [lo, hi)
+   *
+   * \param[in, out] run - free beats right before the subtree, since
+   * fromBeat
+   * \return start beat, or -1 if the subtree holds none
+   */
+  int findFirstFree(const int node, const int lo, const int hi,
+                    const int fromBeat, const int length, int* run) const;
+
+  /**
+   * \brief Find the last start beat of a free range of the given length that
+   * ends at or before toBeat, in the subtree of node covering the beats
+   * [lo, hi)
+   *
+   * \param[in, out] run - free beats right after the subtree, until toBeat
+   * \return start beat, or -1 if the subtree holds none
+   */
+  int findLastFree(const int node, const int lo, const int hi,
+                   const int toBeat, const int length, int* run) const;
+};
+
+#endif  // SRC_BEAT_OCCUPANCY_H_
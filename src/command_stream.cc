@@ -0,0 +1,112 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/command_stream.h"
+
+#include <algorithm>
+#include <limits>
+
+CommandStream::CommandStream(QDataStream* initStream) {
+  quint32 nCommands = 0;
+  *initStream >> nCommands;
+
+  mCommands.reserve(nCommands);
+  for (size_t i = 0; i < nCommands && !initStream->atEnd(); ++i) {
+    Command command;
+    *initStream >> command.frame >> command.velocityLeft >>
+        command.velocityRight >> command.leds;
+    mCommands.push_back(command);
+  }
+}
+
+void CommandStream::serializeToStream(QDataStream* stream) const {
+  *stream << static_cast<quint32>(mCommands.size());
+  for (const Command& command : mCommands) {
+    *stream << command.frame << command.velocityLeft << command.velocityRight
+            << command.leds;
+  }
+}
+
+void CommandStream::findRange(const quint32 startFrame, const quint32 endFrame,
+                              size_t* first, size_t* last) const {
+  auto isBefore = [](const Command& command, const quint32 frame) {
+    return command.frame < frame;
+  };
+  auto firstIt = std::lower_bound(mCommands.begin(), mCommands.end(),
+                                  startFrame, isBefore);
+  auto lastIt = std::lower_bound(firstIt, mCommands.end(), endFrame, isBefore);
+  *first = static_cast<size_t>(firstIt - mCommands.begin());
+  *last = static_cast<size_t>(lastIt - mCommands.begin());
+}
+
+CommandStream::Command* CommandStream::replace(const quint32 startFrame,
+                                               const quint32 endFrame,
+                                               const size_t nCommands) {
+  size_t first = 0;
+  size_t last = 0;
+  findRange(startFrame, endFrame, &first, &last);
+
+  // keep the commands in place as far as possible, then insert or erase the
+  // rest:
+  if (nCommands > last - first) {
+    mCommands.insert(mCommands.begin() + last, nCommands - (last - first),
+                     Command());
+  } else {
+    mCommands.erase(mCommands.begin() + first + nCommands,
+                    mCommands.begin() + last);
+  }
+  return mCommands.data() + first;
+}
+
+bool CommandStream::findDifference(const CommandStream& other,
+                                   quint32* startFrame,
+                                   quint32* endFrame) const {
+  const std::vector<Command>& a = mCommands;
+  const std::vector<Command>& b = other.mCommands;
+
+  // compare from the front:
+  size_t nSameFront = 0;
+  const size_t nMin = std::min(a.size(), b.size());
+  while (nSameFront < nMin && a[nSameFront] == b[nSameFront]) {
+    ++nSameFront;
+  }
+  if (nSameFront == a.size() && nSameFront == b.size()) {
+    return false;
+  }
+
+  // and from the back, without overlapping the front part:
+  size_t nSameBack = 0;
+  while (nSameBack < nMin - nSameFront &&
+         a[a.size() - 1 - nSameBack] == b[b.size() - 1 - nSameBack]) {
+    ++nSameBack;
+  }
+
+  // the difference starts at the first differing command of either stream,
+  // and ends at the first identical command at the back
+  *startFrame = std::numeric_limits<quint32>::max();
+  if (nSameFront < a.size()) {
+    *startFrame = a[nSameFront].frame;
+  }
+  if (nSameFront < b.size()) {
+    *startFrame = std::min(*startFrame, b[nSameFront].frame);
+  }
+  *endFrame = nSameBack > 0 ? a[a.size() - nSameBack].frame
+                            : std::numeric_limits<quint32>::max();
+  return true;
+}
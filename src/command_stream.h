@@ -0,0 +1,120 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_COMMAND_STREAM_H_
+#define SRC_COMMAND_STREAM_H_
+
+#include <QDataStream>
+#include <vector>
+
+/** \class CommandStream
+ * \brief Timed list of Dancebot commands, the intermediate representation
+ * between the primitives and the data audio signal. The commands are sorted by
+ * their start frame in the audio data.
+ */
+class CommandStream {
+ public:
+  /** Single command as sent to the Dancebot */
+  struct Command {
+    quint32 frame{0};          /**< start frame of command in audio data */
+    quint8 velocityLeft{0};    /**< left velocity byte, bit 7 is direction */
+    quint8 velocityRight{0};   /**< right velocity byte, bit 7 is direction */
+    quint8 leds{0};            /**< led byte, one bit per led */
+
+    bool operator==(const Command& other) const {
+      return frame == other.frame && velocityLeft == other.velocityLeft &&
+             velocityRight == other.velocityRight && leds == other.leds;
+    }
+    bool operator!=(const Command& other) const { return !(*this == other); }
+  };
+
+  /** \brief Default constructor that returns an empty stream
+   */
+  CommandStream(void) {}
+
+  /**
+   * \brief Construct command stream from data stream
+   */
+  explicit CommandStream(QDataStream* initStream);
+
+  /**
+   * \brief Serialize command stream to data stream
+   */
+  void serializeToStream(QDataStream* stream) const;
+
+  /**
+   * \brief Get all commands
+   */
+  const std::vector<Command>& getCommands(void) const { return mCommands; }
+
+  /**
+   * \brief Remove all commands
+   */
+  void clear(void) { mCommands.clear(); }
+
+  /**
+   * \brief Find the commands starting in a frame range.
+   *
+   * \param[in] startFrame - first frame of the range
+   * \param[in] endFrame - one beyond the last frame of the range
+   * \param[out] first - index of first command starting in the range
+   * \param[out] last - one beyond the index of the last command in the range
+   */
+  void findRange(const quint32 startFrame, const quint32 endFrame,
+                 size_t* first, size_t* last) const;
+
+  /**
+   * \brief Replace the commands starting in a frame range by a number of
+   * default commands, which the caller then overwrites in place. The commands
+   * written have to be sorted and start in the given range. The returned
+   * pointer is valid until the stream is modified.
+   *
+   * \param[in] startFrame - first frame of the range
+   * \param[in] endFrame - one beyond the last frame of the range
+   * \param[in] nCommands - number of commands to replace the range with
+   * \return pointer to the first of the new commands
+   */
+  Command* replace(const quint32 startFrame, const quint32 endFrame,
+                   const size_t nCommands);
+
+  /**
+   * \brief Find the frame range in which two command streams differ.
+   *
+   * \param[in] other - the command stream to compare to
+   * \param[out] startFrame - start frame of the first differing command
+   * \param[out] endFrame - start frame of the first identical command after
+   * the difference, or the maximum quint32 value if the streams differ up to
+   * their end
+   * \return whether the streams differ (true) or not (false)
+   */
+  bool findDifference(const CommandStream& other, quint32* startFrame,
+                      quint32* endFrame) const;
+
+  bool operator==(const CommandStream& other) const {
+    return mCommands == other.mCommands;
+  }
+  bool operator!=(const CommandStream& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  std::vector<Command> mCommands;
+};
+
+#endif  // SRC_COMMAND_STREAM_H_
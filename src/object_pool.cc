@@ -0,0 +1,133 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/object_pool.h"
+
+#include <QDebug>
+#include <QQmlContext>
+#include <QQmlEngine>
+
+#include <algorithm>
+#include <utility>
+
+ObjectPool::ObjectPool(QObject* parent) : QObject{parent} {}
+
+void ObjectPool::setComponent(QQmlComponent* component) {
+  if (component == mComponent) {
+    return;
+  }
+  mComponent = component;
+  // the destroyed handlers remove items from mAvailable, so take them out
+  // before deleting:
+  const QVector<QQuickItem*> items = std::exchange(mAvailable, {});
+  qDeleteAll(items);
+  emit componentChanged();
+  emit availableChanged();
+}
+
+void ObjectPool::setMaxAvailable(const int maxAvailable) {
+  if (maxAvailable == mMaxAvailable || maxAvailable < 0) {
+    return;
+  }
+  mMaxAvailable = maxAvailable;
+  while (mAvailable.size() > mMaxAvailable) {
+    delete mAvailable.takeLast();
+  }
+  emit maxAvailableChanged();
+  emit availableChanged();
+}
+
+QQuickItem* ObjectPool::acquire(QQuickItem* parent) {
+  QQuickItem* item = nullptr;
+  if (mAvailable.isEmpty()) {
+    item = create(parent);
+    if (!item) {
+      return nullptr;
+    }
+  } else {
+    item = mAvailable.takeLast();
+    item->setParentItem(parent);
+    emit availableChanged();
+  }
+  mInUse.insert(item);
+  // return to the pool if the visual parent is destroyed:
+  connect(item, &QQuickItem::parentChanged, this,
+          [this, item](QQuickItem* newParent) {
+            if (!newParent) {
+              release(item);
+            }
+          });
+  return item;
+}
+
+void ObjectPool::release(QQuickItem* item) {
+  if (!item || !mInUse.remove(item)) {
+    return;
+  }
+  disconnect(item, &QQuickItem::parentChanged, this, nullptr);
+  item->setParentItem(nullptr);
+  if (mAvailable.size() >= mMaxAvailable) {
+    item->deleteLater();
+    return;
+  }
+  mAvailable.append(item);
+  emit availableChanged();
+}
+
+void ObjectPool::reserve(const int count) {
+  const int nAvailable = std::min(count, mMaxAvailable);
+  while (mAvailable.size() < nAvailable) {
+    QQuickItem* item = create(nullptr);
+    if (!item) {
+      break;
+    }
+    mAvailable.append(item);
+  }
+  emit availableChanged();
+}
+
+QQuickItem* ObjectPool::create(QQuickItem* parent) {
+  if (!mComponent) {
+    return nullptr;
+  }
+  // create in the context the component is declared in, such that the items
+  // resolve the same names as if created there:
+  QQmlContext* context = mComponent->creationContext();
+  if (!context) {
+    context = qmlContext(this);
+  }
+  QObject* object = mComponent->beginCreate(context);
+  QQuickItem* item = qobject_cast<QQuickItem*>(object);
+  if (!item) {
+    qDebug() << "ObjectPool: component does not create an item"
+             << mComponent->errors();
+    delete object;
+    return nullptr;
+  }
+  QQmlEngine::setObjectOwnership(item, QQmlEngine::CppOwnership);
+  item->setParent(this);
+  connect(item, &QObject::destroyed, this, [this](QObject* destroyed) {
+    QQuickItem* destroyedItem = static_cast<QQuickItem*>(destroyed);
+    mInUse.remove(destroyedItem);
+    mAvailable.removeAll(destroyedItem);
+  });
+  item->setParentItem(parent);
+  mComponent->completeCreate();
+  return item;
+}
@@ -0,0 +1,106 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_OBJECT_POOL_H_
+#define SRC_OBJECT_POOL_H_
+
+#include <QObject>
+#include <QPointer>
+#include <QQmlComponent>
+#include <QQuickItem>
+#include <QSet>
+#include <QVector>
+
+/** \class ObjectPool
+ * \brief Recycles QML items created from a component, instead of creating
+ * and destroying them.
+ *
+ * Acquired items are shown by parenting them to a visual parent, released
+ * items are hidden by removing their visual parent and kept for the next
+ * acquire. The pool owns all items it created, such that they are never
+ * collected by the JavaScript garbage collector. An item whose visual parent
+ * is destroyed returns to the pool on its own.
+ */
+class ObjectPool : public QObject {
+  Q_OBJECT;
+  Q_PROPERTY(QQmlComponent* component READ component WRITE setComponent
+                 NOTIFY componentChanged);
+  Q_PROPERTY(int maxAvailable READ maxAvailable WRITE setMaxAvailable NOTIFY
+                 maxAvailableChanged);
+  Q_PROPERTY(int available READ available NOTIFY availableChanged);
+
+ public:
+  explicit ObjectPool(QObject* parent = nullptr);
+
+  QQmlComponent* component(void) const { return mComponent; }
+  int maxAvailable(void) const { return mMaxAvailable; }
+  int available(void) const { return mAvailable.size(); }
+
+  /**
+   * \brief Set the component to create items from. Items of a previous
+   * component that are not in use are deleted.
+   */
+  void setComponent(QQmlComponent* component);
+
+  /**
+   * \brief Set the number of released items kept for reuse, further items
+   * are deleted on release
+   */
+  void setMaxAvailable(const int maxAvailable);
+
+  /**
+   * \brief Get an item of the pool, creating one if none is available
+   *
+   * \param[in] parent - visual parent to show the item in
+   * \return the item, or nullptr if it could not be created
+   */
+  Q_INVOKABLE QQuickItem* acquire(QQuickItem* parent);
+
+  /**
+   * \brief Return an item to the pool. Its properties are left as they are.
+   *
+   * \param[in] item - item acquired from this pool
+   */
+  Q_INVOKABLE void release(QQuickItem* item);
+
+  /**
+   * \brief Create items until a number of them is available, e.g. to avoid
+   * creating them during an interaction
+   */
+  Q_INVOKABLE void reserve(const int count);
+
+  // NOLINTNEXTLINE
+ signals:
+  void componentChanged(void);
+  void maxAvailableChanged(void);
+  void availableChanged(void);
+
+ private:
+  QPointer<QQmlComponent> mComponent;
+  int mMaxAvailable{64};
+  QVector<QQuickItem*> mAvailable;
+  QSet<QQuickItem*> mInUse;
+
+  /**
+   * \brief Create an item of the component, shown in a visual parent
+   */
+  QQuickItem* create(QQuickItem* parent);
+};
+
+#endif  // SRC_OBJECT_POOL_H_
@@ -0,0 +1,212 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/playhead_item.h"
+
+#include <QQuickWindow>
+#include <QSGSimpleRectNode>
+#include <QSGTransformNode>
+
+#include <algorithm>
+
+PlayheadItem::PlayheadItem(QQuickItem* parent) : QQuickItem{parent} {
+  setFlag(ItemHasContents, true);
+}
+
+void PlayheadItem::setAudioPlayer(AudioPlayer* audioPlayer) {
+  if (audioPlayer == mAudioPlayer) {
+    return;
+  }
+  if (mAudioPlayer) {
+    disconnect(mAudioPlayer, nullptr, this, nullptr);
+  }
+  mAudioPlayer = audioPlayer;
+  if (mAudioPlayer) {
+    connect(mAudioPlayer, &AudioPlayer::notify, this,
+            [this]() { advance(true); });
+    connect(mAudioPlayer, &AudioPlayer::isPlayingChanged, this,
+            [this]() { advance(true); });
+  }
+  emit audioPlayerChanged();
+  advance(false);
+}
+
+void PlayheadItem::setFollowPlayer(const bool followPlayer) {
+  if (followPlayer == mFollowPlayer) {
+    return;
+  }
+  mFollowPlayer = followPlayer;
+  emit followPlayerChanged();
+  advance(false);
+}
+
+void PlayheadItem::setFrameToPixels(const qreal frameToPixels) {
+  if (frameToPixels == mFrameToPixels || frameToPixels <= 0.0) {
+    return;
+  }
+  mFrameToPixels = frameToPixels;
+  emit frameToPixelsChanged();
+  update();
+}
+
+void PlayheadItem::setColor(const QColor& color) {
+  if (color == mColor) {
+    return;
+  }
+  mColor = color;
+  mStyleDirty = true;
+  emit colorChanged();
+  update();
+}
+
+void PlayheadItem::setIndicatorWidth(const qreal width) {
+  if (width == mIndicatorWidth) {
+    return;
+  }
+  mIndicatorWidth = width;
+  mStyleDirty = true;
+  emit indicatorWidthChanged();
+  update();
+}
+
+void PlayheadItem::setIndicatorHeight(const qreal height) {
+  if (height == mIndicatorHeight) {
+    return;
+  }
+  mIndicatorHeight = height;
+  mStyleDirty = true;
+  emit indicatorHeightChanged();
+  update();
+}
+
+void PlayheadItem::setFlickable(QQuickItem* flickable) {
+  if (flickable == mFlickable) {
+    return;
+  }
+  mFlickable = flickable;
+  emit flickableChanged();
+}
+
+void PlayheadItem::setAutoScroll(const bool autoScroll) {
+  if (autoScroll == mAutoScroll) {
+    return;
+  }
+  mAutoScroll = autoScroll;
+  emit autoScrollChanged();
+}
+
+void PlayheadItem::setScrollOffset(const qreal offset) {
+  if (offset == mScrollOffset) {
+    return;
+  }
+  mScrollOffset = offset;
+  emit scrollOffsetChanged();
+}
+
+void PlayheadItem::showFrame(const qreal frame) { moveTo(frame, true); }
+
+void PlayheadItem::advance(const bool scroll) {
+  if (!mAudioPlayer || !mFollowPlayer) {
+    return;
+  }
+  moveTo(static_cast<qreal>(mAudioPlayer->getCurrentPlaybackFrame()), scroll);
+  if (mAudioPlayer->isPlaying()) {
+    // render another frame, which calls back on frameSwapped:
+    update();
+  }
+}
+
+void PlayheadItem::moveTo(const qreal frame, const bool scroll) {
+  if (frame == mFrame) {
+    return;
+  }
+  mFrame = frame;
+  if (scroll && mAutoScroll) {
+    scrollIntoView();
+  }
+  update();
+}
+
+void PlayheadItem::scrollIntoView(void) {
+  if (!mFlickable) {
+    return;
+  }
+  const qreal position = mFrame * mFrameToPixels;
+  const qreal contentX = mFlickable->property("contentX").toReal();
+  if (position < contentX || position > contentX + mFlickable->width()) {
+    mFlickable->setProperty("contentX",
+                            std::max(0.0, position - mScrollOffset));
+  }
+}
+
+void PlayheadItem::handleFrameSwapped(void) {
+  if (mAudioPlayer && mAudioPlayer->isPlaying()) {
+    advance(true);
+  }
+}
+
+void PlayheadItem::itemChange(ItemChange change,
+                              const ItemChangeData& value) {
+  if (change == ItemSceneChange) {
+    if (mWindow) {
+      disconnect(mWindow, nullptr, this, nullptr);
+    }
+    mWindow = value.window;
+    if (mWindow) {
+      // frameSwapped is emitted on the render thread, handle it on the GUI
+      // thread once the frame is presented:
+      connect(mWindow, &QQuickWindow::frameSwapped, this,
+              &PlayheadItem::handleFrameSwapped, Qt::QueuedConnection);
+    }
+  }
+  QQuickItem::itemChange(change, value);
+}
+
+void PlayheadItem::geometryChanged(const QRectF& newGeometry,
+                                   const QRectF& oldGeometry) {
+  QQuickItem::geometryChanged(newGeometry, oldGeometry);
+  // the indicator is centered vertically:
+  mStyleDirty = true;
+  update();
+}
+
+QSGNode* PlayheadItem::updatePaintNode(
+    QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData) {
+  Q_UNUSED(updatePaintNodeData);
+  QSGTransformNode* root = static_cast<QSGTransformNode*>(oldNode);
+  if (!root) {
+    root = new QSGTransformNode();
+    root->appendChildNode(new QSGSimpleRectNode());
+    mStyleDirty = true;
+  }
+  if (mStyleDirty) {
+    QSGSimpleRectNode* indicator =
+        static_cast<QSGSimpleRectNode*>(root->firstChild());
+    indicator->setRect(QRectF(-mIndicatorWidth / 2.0,
+                              (height() - mIndicatorHeight) / 2.0,
+                              mIndicatorWidth, mIndicatorHeight));
+    indicator->setColor(mColor);
+    mStyleDirty = false;
+  }
+  // moving the playhead only changes the transform:
+  QMatrix4x4 matrix;
+  matrix.translate(static_cast<float>(mFrame * mFrameToPixels), 0.0f);
+  root->setMatrix(matrix);
+  return root;
+}
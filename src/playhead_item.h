@@ -0,0 +1,169 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_PLAYHEAD_ITEM_H_
+#define SRC_PLAYHEAD_ITEM_H_
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+
+#include "src/audio_player.h"
+
+/** \class PlayheadItem
+ * \brief Scene graph QML item drawing the playhead over the timeline.
+ *
+ * The item covers the whole timeline content and draws a vertical bar at the
+ * frame currently played back. During playback, the interpolated audio clock
+ * is read once per frame rendered by the window, and the bar is moved by a
+ * transform node only, such that no QML bindings are evaluated per frame.
+ * The item can also keep the playhead in view by scrolling a Flickable.
+ */
+class PlayheadItem : public QQuickItem {
+  Q_OBJECT;
+  Q_PROPERTY(AudioPlayer* audioPlayer READ audioPlayer WRITE setAudioPlayer
+                 NOTIFY audioPlayerChanged);
+  Q_PROPERTY(qreal frameToPixels READ frameToPixels WRITE setFrameToPixels
+                 NOTIFY frameToPixelsChanged);
+  Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged);
+  Q_PROPERTY(qreal indicatorWidth READ indicatorWidth WRITE setIndicatorWidth
+                 NOTIFY indicatorWidthChanged);
+  Q_PROPERTY(qreal indicatorHeight READ indicatorHeight WRITE
+                 setIndicatorHeight NOTIFY indicatorHeightChanged);
+  Q_PROPERTY(bool followPlayer READ followPlayer WRITE setFollowPlayer NOTIFY
+                 followPlayerChanged);
+  Q_PROPERTY(QQuickItem* flickable READ flickable WRITE setFlickable NOTIFY
+                 flickableChanged);
+  Q_PROPERTY(bool autoScroll READ autoScroll WRITE setAutoScroll NOTIFY
+                 autoScrollChanged);
+  Q_PROPERTY(qreal scrollOffset READ scrollOffset WRITE setScrollOffset NOTIFY
+                 scrollOffsetChanged);
+
+ public:
+  explicit PlayheadItem(QQuickItem* parent = nullptr);
+
+  AudioPlayer* audioPlayer(void) const { return mAudioPlayer; }
+  qreal frameToPixels(void) const { return mFrameToPixels; }
+  QColor color(void) const { return mColor; }
+  qreal indicatorWidth(void) const { return mIndicatorWidth; }
+  qreal indicatorHeight(void) const { return mIndicatorHeight; }
+  bool followPlayer(void) const { return mFollowPlayer; }
+  QQuickItem* flickable(void) const { return mFlickable; }
+  bool autoScroll(void) const { return mAutoScroll; }
+  qreal scrollOffset(void) const { return mScrollOffset; }
+
+  /**
+   * \brief Set the player to follow. The playhead is updated every frame
+   * during playback, and at every notify of the player otherwise.
+   */
+  void setAudioPlayer(AudioPlayer* audioPlayer);
+
+  /**
+   * \brief Set if the playhead shows the position of the player. Disable to
+   * show frames set by showFrame only, e.g. while the song position slider is
+   * dragged.
+   */
+  void setFollowPlayer(const bool followPlayer);
+
+  void setFrameToPixels(const qreal frameToPixels);
+  void setColor(const QColor& color);
+  void setIndicatorWidth(const qreal width);
+  void setIndicatorHeight(const qreal height);
+
+  /**
+   * \brief Set the Flickable showing the timeline, which is scrolled to keep
+   * the playhead in view if autoScroll is set
+   */
+  void setFlickable(QQuickItem* flickable);
+
+  void setAutoScroll(const bool autoScroll);
+
+  /**
+   * \brief Set the distance in pixels from the left edge of the view at which
+   * the playhead is placed when scrolling
+   */
+  void setScrollOffset(const qreal offset);
+
+  /**
+   * \brief Show the playhead at a frame without reading the player. Unless
+   * followPlayer is disabled, the player takes over again at its next notify
+   * or rendered frame during playback.
+   *
+   * \param[in] frame - frame in the audio data
+   */
+  Q_INVOKABLE void showFrame(const qreal frame);
+
+  // NOLINTNEXTLINE
+ signals:
+  void audioPlayerChanged(void);
+  void followPlayerChanged(void);
+  void frameToPixelsChanged(void);
+  void colorChanged(void);
+  void indicatorWidthChanged(void);
+  void indicatorHeightChanged(void);
+  void flickableChanged(void);
+  void autoScrollChanged(void);
+  void scrollOffsetChanged(void);
+
+ protected:
+  QSGNode* updatePaintNode(QSGNode* oldNode,
+                           UpdatePaintNodeData* updatePaintNodeData) override;
+  void itemChange(ItemChange change, const ItemChangeData& value) override;
+  void geometryChanged(const QRectF& newGeometry,
+                       const QRectF& oldGeometry) override;
+
+ private:
+  QPointer<AudioPlayer> mAudioPlayer;
+  QPointer<QQuickItem> mFlickable;
+  QPointer<QQuickWindow> mWindow;
+  qreal mFrameToPixels{1.0};
+  QColor mColor{Qt::red};
+  qreal mIndicatorWidth{2.0};
+  qreal mIndicatorHeight{0.0};
+  bool mFollowPlayer{true};
+  bool mAutoScroll{true};
+  qreal mScrollOffset{0.0};
+  qreal mFrame{0.0};     /**< frame at the playhead */
+  bool mStyleDirty{true}; /**< indicator size or color changed */
+
+  /**
+   * \brief Read the player clock and move the playhead. Keeps requesting
+   * frames from the window while the player is playing.
+   *
+   * \param[in] scroll - scroll the Flickable if the playhead left the view
+   */
+  void advance(const bool scroll);
+
+  /**
+   * \brief Move the playhead to a frame
+   */
+  void moveTo(const qreal frame, const bool scroll);
+
+  /**
+   * \brief Scroll the Flickable such that the playhead is visible
+   */
+  void scrollIntoView(void);
+
+  /**
+   * \brief Called on the GUI thread after the window presented a frame
+   */
+  void handleFrameSwapped(void);
+};
+
+#endif  // SRC_PLAYHEAD_ITEM_H_
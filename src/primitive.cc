@@ -19,6 +19,8 @@
 
 #include "src/primitive.h"
 
+#include <random>
+
 MotorPrimitive::MotorPrimitive(QObject* const parent) : BasePrimitive{parent} {}
 
 MotorPrimitive::MotorPrimitive(QDataStream* initStream, QObject* const parent)
@@ -58,11 +60,18 @@ void MotorPrimitive::serializeToStream(QDataStream* stream) const {
           << velocityRight;
 }
 
+namespace {
+quint32 generateSeed(void) {
+  static std::random_device rd;
+  return static_cast<quint32>(rd());
+}
+}  // namespace
+
 LEDPrimitive::LEDPrimitive(QObject* const parent)
-    : BasePrimitive{parent}, mLeds(8, true) {}
+    : BasePrimitive{parent}, mLeds(8, true), mSeed{generateSeed()} {}
 
 LEDPrimitive::LEDPrimitive(QDataStream* initStream, QObject* const parent)
-    : BasePrimitive{parent}, mLeds(8, true) {
+    : BasePrimitive{parent}, mLeds(8, true), mSeed{generateSeed()} {
   // and initialize members from data stream
   quint16 beatPosition = 0;
   quint16 beatLength = 0;
@@ -98,6 +107,14 @@ void LEDPrimitive::serializeToStream(QDataStream* stream) const {
   *stream << beatPosition << beatLength << type << frequency << leds;
 }
 
+void LEDPrimitive::serializeSeedToStream(QDataStream* stream) const {
+  *stream << mSeed;
+}
+
+void LEDPrimitive::readSeedFromStream(QDataStream* stream) {
+  *stream >> mSeed;
+}
+
 quint8 LEDPrimitive::getLedByte(void) const {
   quint8 leds = 0u;
   for (size_t i = 0; i < mLeds.size(); ++i) {
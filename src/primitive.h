@@ -112,6 +112,7 @@ class LEDPrimitive : public BasePrimitive {
 
   Q_PROPERTY(std::vector<bool> leds MEMBER mLeds NOTIFY ledsChanged);
   Q_PROPERTY(Type type MEMBER mType NOTIFY typeChanged);
+  Q_PROPERTY(quint32 seed MEMBER mSeed NOTIFY seedChanged);
 
  public:
   enum class Type {
@@ -134,12 +135,26 @@ class LEDPrimitive : public BasePrimitive {
   // public members
   std::vector<bool> mLeds;
   Type mType{Type::KnightRider};
+  // seed of the random led pattern, initialized randomly on construction
+  quint32 mSeed{0};
 
   /**
    * \brief Serialize motor primitive to data stream
    */
   void serializeToStream(QDataStream* stream) const override;
 
+  /**
+   * \brief Serialize seed to data stream. The seed is not part of
+   * serializeToStream, but written after all primitives to keep dance files
+   * readable by older versions.
+   */
+  void serializeSeedToStream(QDataStream* stream) const;
+
+  /**
+   * \brief Read seed from data stream written by serializeSeedToStream
+   */
+  void readSeedFromStream(QDataStream* stream);
+
   /**
    * \brief Convert LED vector to single byte
    */
@@ -148,6 +163,7 @@ class LEDPrimitive : public BasePrimitive {
  signals:
   void ledsChanged(void);
   void typeChanged(void);
+  void seedChanged(void);
 };
 
 #endif  // SRC_PRIMITIVE_H_
@@ -20,6 +20,9 @@
 #include "src/primitive_list.h"
 
 #include <QDebug>
+#include <QMetaProperty>
+
+#include <algorithm>
 
 #include "src/primitive.h"
 
@@ -31,6 +34,8 @@ int PrimitiveList::rowCount(const QModelIndex& parent) const {
   return mData.size();
 }
 
+int PrimitiveList::count(void) const { return mData.size(); }
+
 QVariant PrimitiveList::data(const QModelIndex& index, int role) const {
   if (Qt::UserRole + 1 == role && index.row() >= 0 &&
       index.row() < mData.size()) {
@@ -61,6 +66,11 @@ void PrimitiveList::add(QObject* o) {
   // This is very important to prevent items to be garbage collected in JS!!!
   o->setParent(this);
   endInsertRows();
+
+  // track changes to the primitive to know what to re-render
+  connectPrimitive(o);
+  updatePrimitiveRange(o);
+  emit countChanged();
 }
 
 void PrimitiveList::remove(QObject* object) {
@@ -81,9 +91,18 @@ void PrimitiveList::remove(QObject* object) {
   // start removal notification
   // data inserted at top level, hence first arg. QModelIndex()
   beginRemoveRows(QModelIndex(), index, index);
+  // stop tracking the primitive and mark its beats dirty
+  disconnect(object, nullptr, this, nullptr);
+  const QPair<int, int> range = mPrimitiveRanges.take(object);
+  markDirty(range.first, range.second);
+  if (!mFloating.remove(object)) {
+    mOccupancy.free(range.first, range.second);
+  }
   mData.at(index)->setParent(nullptr);
   mData.removeAt(index);
+  mSortedData.removeOne(object);
   endRemoveRows();
+  emit countChanged();
 }
 
 void PrimitiveList::clear(void) {
@@ -92,8 +111,119 @@ void PrimitiveList::clear(void) {
     return;
   }
   beginRemoveRows(QModelIndex(), 0, mData.size() - 1);
+  for (QObject* o : mData) {
+    disconnect(o, nullptr, this, nullptr);
+  }
+  for (const auto& range : mPrimitiveRanges) {
+    markDirty(range.first, range.second);
+  }
+  mPrimitiveRanges.clear();
+  mOccupancy.clear();
+  mFloating.clear();
   mData.clear();
+  mSortedData.clear();
   endRemoveRows();
+  emit countChanged();
+}
+
+void PrimitiveList::beginBatch(void) {
+  mBatch.clear();
+  mBatchActive = true;
+}
+
+void PrimitiveList::setBatchRange(QObject* o, const int positionBeat,
+                                  const int lengthBeat) {
+  if (!mBatchActive || !mPrimitiveRanges.contains(o)) {
+    return;
+  }
+  for (auto& change : mBatch) {
+    if (change.primitive == o) {
+      change.positionBeat = positionBeat;
+      change.lengthBeat = lengthBeat;
+      return;
+    }
+  }
+  mBatch.append(BatchChange{o, positionBeat, lengthBeat});
+}
+
+bool PrimitiveList::commitBatch(void) {
+  const QVector<BatchChange> batch = mBatch;
+  cancelBatch();
+
+  // release the current beats of the batch to validate against the other
+  // primitives only:
+  for (const auto& change : batch) {
+    if (!mFloating.contains(change.primitive)) {
+      const QPair<int, int> range = mPrimitiveRanges.value(change.primitive);
+      mOccupancy.free(range.first, range.second);
+    }
+  }
+
+  // occupy the new ranges one by one, which also catches overlaps within the
+  // batch:
+  int nPlaced = 0;
+  for (const auto& change : batch) {
+    const int endBeat = change.positionBeat + change.lengthBeat;
+    if (!mOccupancy.isFree(change.positionBeat, endBeat)) {
+      break;
+    }
+    mOccupancy.occupy(change.positionBeat, endBeat);
+    ++nPlaced;
+  }
+
+  if (nPlaced < batch.size()) {
+    // invalid, restore previous occupancy
+    for (int i = 0; i < nPlaced; ++i) {
+      mOccupancy.free(batch[i].positionBeat,
+                      batch[i].positionBeat + batch[i].lengthBeat);
+    }
+    for (const auto& change : batch) {
+      if (!mFloating.contains(change.primitive)) {
+        const QPair<int, int> range = mPrimitiveRanges.value(change.primitive);
+        mOccupancy.occupy(range.first, range.second);
+      }
+    }
+    return false;
+  }
+
+  // apply without per-property notifications, collecting dirty beats and
+  // changed rows:
+  int dirtyStartBeat = -1;
+  int dirtyEndBeat = -1;
+  int firstRow = mData.size();
+  int lastRow = -1;
+  for (const auto& change : batch) {
+    BasePrimitive* const p = reinterpret_cast<BasePrimitive*>(change.primitive);
+    const QPair<int, int> previous = mPrimitiveRanges.value(change.primitive);
+    const QPair<int, int> range{change.positionBeat,
+                                change.positionBeat + change.lengthBeat};
+    mSortedValid = mSortedValid && p->mPositionBeat == change.positionBeat;
+    p->mPositionBeat = change.positionBeat;
+    p->mLengthBeat = change.lengthBeat;
+    mPrimitiveRanges.insert(change.primitive, range);
+    mFloating.remove(change.primitive);
+
+    const int startBeat = std::min(previous.first, range.first);
+    const int endBeat = std::max(previous.second, range.second);
+    dirtyStartBeat =
+        dirtyStartBeat < 0 ? startBeat : std::min(dirtyStartBeat, startBeat);
+    dirtyEndBeat = std::max(dirtyEndBeat, endBeat);
+
+    const int row = mData.indexOf(change.primitive);
+    firstRow = std::min(firstRow, row);
+    lastRow = std::max(lastRow, row);
+  }
+  markDirty(dirtyStartBeat, dirtyEndBeat);
+  if (firstRow <= lastRow) {
+    dataChanged(createIndex(firstRow, 0), createIndex(lastRow, 0),
+                QVector<int>{Qt::UserRole + 1});
+  }
+  return true;
+}
+
+void PrimitiveList::cancelBatch(void) {
+  mBatch.clear();
+  mBatchActive = false;
 }
 
 void PrimitiveList::printPrimitives(void) const {
@@ -118,3 +248,121 @@ bool PrimitiveList::setData(const QModelIndex& index, const QVariant& value,
 }
 
 const QList<QObject*>& PrimitiveList::getData(void) { return mData; }
+
+const QList<QObject*>& PrimitiveList::getSortedData(void) {
+  if (!mSortedValid) {
+    mSortedData = mData;
+    std::stable_sort(mSortedData.begin(), mSortedData.end(),
+                     [](const QObject* const a, const QObject* const b) {
+                       return reinterpret_cast<const BasePrimitive*>(a)
+                                  ->mPositionBeat <
+                              reinterpret_cast<const BasePrimitive*>(b)
+                                  ->mPositionBeat;
+                     });
+    mSortedValid = true;
+  }
+  return mSortedData;
+}
+
+void PrimitiveList::setNumBeats(const int numBeats) {
+  mOccupancy.setNumBeats(numBeats);
+}
+
+bool PrimitiveList::isFree(const int startBeat, const int endBeat) const {
+  return mOccupancy.isFree(startBeat, endBeat);
+}
+
+int PrimitiveList::getFreeLength(const int startBeat,
+                                 const int maxLength) const {
+  return mOccupancy.getFreeLength(startBeat, maxLength);
+}
+
+int PrimitiveList::getNearestFreeBeat(const int beat, const int length) const {
+  return mOccupancy.getNearestFreeStart(beat, length);
+}
+
+void PrimitiveList::setFloating(QObject* o, const bool floating) {
+  if (!mPrimitiveRanges.contains(o) || floating == mFloating.contains(o)) {
+    return;
+  }
+  const QPair<int, int> range = mPrimitiveRanges.value(o);
+  if (floating) {
+    mFloating.insert(o);
+    mOccupancy.free(range.first, range.second);
+  } else {
+    mFloating.remove(o);
+    mOccupancy.occupy(range.first, range.second);
+  }
+}
+
+bool PrimitiveList::getDirtyRange(int* startBeat, int* endBeat) const {
+  if (mDirtyStartBeat >= mDirtyEndBeat) {
+    return false;
+  }
+  *startBeat = mDirtyStartBeat;
+  *endBeat = mDirtyEndBeat;
+  return true;
+}
+
+void PrimitiveList::clearDirtyRange(void) {
+  mDirtyStartBeat = -1;
+  mDirtyEndBeat = -1;
+}
+
+void PrimitiveList::handlePrimitiveChanged(void) {
+  const QObject* const o = sender();
+  if (!o || !mPrimitiveRanges.contains(o)) {
+    return;
+  }
+  // both the vacated and the newly covered beats need re-rendering
+  const QPair<int, int> range = mPrimitiveRanges.value(o);
+  markDirty(range.first, range.second);
+  updatePrimitiveRange(o);
+}
+
+void PrimitiveList::connectPrimitive(QObject* o) {
+  // connect all notify signals, such that any property edit, including
+  // position and length changes, is tracked
+  const QMetaMethod handler = staticMetaObject.method(
+      staticMetaObject.indexOfSlot("handlePrimitiveChanged()"));
+  const QMetaObject* const mo = o->metaObject();
+  for (int i = QObject::staticMetaObject.propertyCount();
+       i < mo->propertyCount(); ++i) {
+    const QMetaProperty property = mo->property(i);
+    if (property.hasNotifySignal()) {
+      connect(o, property.notifySignal(), this, handler);
+    }
+  }
+}
+
+void PrimitiveList::markDirty(const int startBeat, const int endBeat) {
+  if (startBeat >= endBeat) {
+    return;
+  }
+  if (mDirtyStartBeat >= mDirtyEndBeat) {
+    mDirtyStartBeat = startBeat;
+    mDirtyEndBeat = endBeat;
+  } else {
+    mDirtyStartBeat = std::min(mDirtyStartBeat, startBeat);
+    mDirtyEndBeat = std::max(mDirtyEndBeat, endBeat);
+  }
+  emit dirtyRangeChanged();
+}
+
+void PrimitiveList::updatePrimitiveRange(const QObject* o) {
+  const BasePrimitive* const p = reinterpret_cast<const BasePrimitive*>(o);
+  const QPair<int, int> range{p->mPositionBeat,
+                              p->mPositionBeat + p->mLengthBeat};
+  const auto previous = mPrimitiveRanges.constFind(o);
+  const bool known = previous != mPrimitiveRanges.constEnd();
+  // new and moved primitives change the sorted order:
+  mSortedValid = mSortedValid && known && previous->first == range.first;
+  if (!mFloating.contains(o)) {
+    if (known) {
+      mOccupancy.free(previous->first, previous->second);
+    }
+    mOccupancy.occupy(range.first, range.second);
+  }
+  mPrimitiveRanges.insert(o, range);
+  markDirty(range.first, range.second);
+}
@@ -21,6 +21,12 @@
 #define SRC_PRIMITIVE_LIST_H_
 
 #include <QAbstractListModel>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+#include "src/beat_occupancy.h"
 
 /** \class PrimitiveList
  * \brief Data model to store motor and led primitives in. See documentation of
@@ -30,6 +36,7 @@ class PrimitiveList : public QAbstractListModel {
   Q_OBJECT;
 
   Q_PROPERTY(QObject* parent READ parent WRITE setParent);
+  Q_PROPERTY(int count READ count NOTIFY countChanged);
 
  public:
   explicit PrimitiveList(QObject* parent);
@@ -39,6 +46,11 @@ class PrimitiveList : public QAbstractListModel {
    */
   int rowCount(const QModelIndex& parent = QModelIndex()) const override;
 
+  /**
+   * \brief Get total number of data items in model
+   */
+  int count(void) const;
+
   /**
    * \brief Get data at given index and role. Primitive data is stored at
    * role Qt::UserRole + 1
@@ -61,6 +73,98 @@ class PrimitiveList : public QAbstractListModel {
    */
   const QList<QObject*>& getData(void);
 
+  /**
+   * \brief Get reference to data in model sorted by position. The order is
+   * cached, and only sorted again after primitives were added or moved.
+   */
+  const QList<QObject*>& getSortedData(void);
+
+  /**
+   * \brief Set the number of beats of the song, which limits the beat ranges
+   * primitives can occupy
+   */
+  void setNumBeats(const int numBeats);
+
+  /**
+   * \brief Check if the beat range [startBeat, endBeat) is within the song
+   * and not occupied by any primitive of the model
+   */
+  Q_INVOKABLE bool isFree(const int startBeat, const int endBeat) const;
+
+  /**
+   * \brief Get the number of free beats starting at startBeat, up to
+   * maxLength, i.e. the length a primitive placed there can have. Returns 0 if
+   * the start beat is occupied.
+   */
+  Q_INVOKABLE int getFreeLength(const int startBeat,
+                                const int maxLength) const;
+
+  /**
+   * \brief Get the free start beat nearest to a beat that fits a primitive of
+   * the given length, or -1 if there is none
+   */
+  Q_INVOKABLE int getNearestFreeBeat(const int beat, const int length) const;
+
+  /**
+   * \brief Set a primitive floating, e.g. while it is dragged. Floating
+   * primitives do not occupy beats, and occupy their current beat range again
+   * once they stop floating.
+   *
+   * \param[in] o - primitive of the model
+   * \param[in] floating - release (true) or occupy (false) its beats
+   */
+  Q_INVOKABLE void setFloating(QObject* o, const bool floating);
+
+  /**
+   * \brief Start a batch of moves and resizes, discarding any uncommitted
+   * batch
+   */
+  Q_INVOKABLE void beginBatch(void);
+
+  /**
+   * \brief Add a move and resize of a primitive of the model to the batch.
+   * Adding the same primitive again replaces its previous range.
+   *
+   * \param[in] o - primitive of the model
+   * \param[in] positionBeat - new position
+   * \param[in] lengthBeat - new length
+   */
+  Q_INVOKABLE void setBatchRange(QObject* o, const int positionBeat,
+                                 const int lengthBeat);
+
+  /**
+   * \brief Apply the batch if all new ranges are free, ignoring the current
+   * ranges of the primitives in the batch, and do not overlap each other.
+   *
+   * The primitives of a valid batch stop floating. Their notify signals are
+   * not emitted; instead, a single dataChanged signal covers all changed rows
+   * and the dirty range grows once.
+   *
+   * \return whether the batch was valid and applied (true) or discarded
+   */
+  Q_INVOKABLE bool commitBatch(void);
+
+  /**
+   * \brief Discard the batch
+   */
+  Q_INVOKABLE void cancelBatch(void);
+
+  /**
+   * \brief Get range of beats affected by changes to the primitives in the
+   * model (adding, removing, moving, resizing, or editing properties) since the
+   * last call to clearDirtyRange.
+   *
+   * \param[out] startBeat - first beat affected by the changes
+   * \param[out] endBeat - one beyond the last beat affected by the changes
+   * \return whether there are any changes (true) or not (false)
+   */
+  bool getDirtyRange(int* startBeat, int* endBeat) const;
+
+  /**
+   * \brief Reset dirty beat range, e.g. after rendering the primitives.
+   */
+  void clearDirtyRange(void);
+
   // NOLINTNEXTLINE
  public slots:
   /**
@@ -92,14 +196,75 @@ class PrimitiveList : public QAbstractListModel {
    */
   void callDataChanged(const int index);
 
+  // NOLINTNEXTLINE
+ signals:
+  /**
+   * \brief Emitted when the dirty beat range grows
+   */
+  void dirtyRangeChanged(void);
+
+  /**
+   * \brief Emitted when items are added or removed
+   */
+  void countChanged(void);
+
  protected:
   /**
    * \brief Defines role names, i.e. maps role numbers to strings to use in qml.
    */
   QHash<int, QByteArray> roleNames() const override;
 
+  // NOLINTNEXTLINE
+ private slots:
+  /**
+   * \brief Handler for property change signals of the primitives in the
+   * model. Marks both the previous and the new beat range of the primitive as
+   * dirty.
+   */
+  void handlePrimitiveChanged(void);
+
  private:
   QList<QObject*> mData;
+
+  // last known beat ranges [start, end) of the primitives in the model, used
+  // to mark the vacated beats dirty when a primitive moves or shrinks
+  QHash<const QObject*, QPair<int, int>> mPrimitiveRanges;
+  int mDirtyStartBeat{-1};
+  int mDirtyEndBeat{-1};
+
+  // data sorted by position, valid unless primitives were added or moved
+  QList<QObject*> mSortedData;
+  bool mSortedValid{false};
+
+  // beats occupied by the primitives that are not floating
+  BeatOccupancy mOccupancy;
+  QSet<const QObject*> mFloating;
+
+  // pending moves and resizes between beginBatch and commitBatch
+  struct BatchChange {
+    QObject* primitive;
+    int positionBeat;
+    int lengthBeat;
+  };
+  QVector<BatchChange> mBatch;
+  bool mBatchActive{false};
+
+  /**
+   * \brief Connect all property notify signals of a primitive to the change
+   * handler.
+   */
+  void connectPrimitive(QObject* o);
+
+  /**
+   * \brief Extend dirty range to include the given beat range
+   */
+  void markDirty(const int startBeat, const int endBeat);
+
+  /**
+   * \brief Mark beat range currently covered by a primitive dirty and store
+   * it as the primitive's last known range, updating the occupied beats.
+   */
+  void updatePrimitiveRange(const QObject* o);
 };
 
 #endif  // SRC_PRIMITIVE_LIST_H_
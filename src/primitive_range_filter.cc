@@ -0,0 +1,151 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/primitive_range_filter.h"
+
+#include <QTimer>
+
+#include <algorithm>
+
+#include "src/primitive.h"
+
+PrimitiveRangeFilter::PrimitiveRangeFilter(QObject* parent)
+    : QSortFilterProxyModel{parent} {}
+
+void PrimitiveRangeFilter::setPrimitives(PrimitiveList* primitives) {
+  if (primitives == mPrimitives) {
+    return;
+  }
+  if (mPrimitives) {
+    disconnect(mPrimitives, nullptr, this, nullptr);
+  }
+  mPrimitives = primitives;
+  mPinned.clear();
+  setSourceModel(mPrimitives);
+  if (mPrimitives) {
+    // primitives moved in or out of the window by editing them:
+    connect(mPrimitives, &PrimitiveList::dirtyRangeChanged, this,
+            &PrimitiveRangeFilter::scheduleInvalidate);
+    connect(mPrimitives, &PrimitiveList::rowsAboutToBeRemoved, this,
+            &PrimitiveRangeFilter::handleRowsAboutToBeRemoved);
+  }
+  emit primitivesChanged();
+}
+
+void PrimitiveRangeFilter::setBeats(BeatModel* beats) {
+  if (beats == mBeats) {
+    return;
+  }
+  if (mBeats) {
+    disconnect(mBeats, nullptr, this, nullptr);
+  }
+  mBeats = beats;
+  if (mBeats) {
+    connect(mBeats, &BeatModel::framesChanged, this,
+            [this]() { updateBeatWindow(true); });
+  }
+  updateBeatWindow(true);
+  emit beatsChanged();
+}
+
+void PrimitiveRangeFilter::setStartFrame(const qreal startFrame) {
+  if (startFrame == mStartFrame) {
+    return;
+  }
+  mStartFrame = startFrame;
+  updateBeatWindow(false);
+  emit startFrameChanged();
+}
+
+void PrimitiveRangeFilter::setEndFrame(const qreal endFrame) {
+  if (endFrame == mEndFrame) {
+    return;
+  }
+  mEndFrame = endFrame;
+  updateBeatWindow(false);
+  emit endFrameChanged();
+}
+
+void PrimitiveRangeFilter::setPinned(QObject* primitive, const bool pinned) {
+  if (pinned) {
+    mPinned.insert(primitive);
+  } else if (mPinned.remove(primitive)) {
+    // the primitive may be outside the window now, but its delegate is still
+    // being processed
+    scheduleInvalidate();
+  }
+}
+
+bool PrimitiveRangeFilter::filterAcceptsRow(
+    int sourceRow, const QModelIndex& sourceParent) const {
+  Q_UNUSED(sourceParent);
+  if (!mPrimitives || sourceRow >= mPrimitives->getData().size()) {
+    return false;
+  }
+  const QObject* const o = mPrimitives->getData().at(sourceRow);
+  if (mPinned.contains(o)) {
+    return true;
+  }
+  const BasePrimitive* const p = reinterpret_cast<const BasePrimitive*>(o);
+  return p->mPositionBeat < mEndBeat &&
+         p->mPositionBeat + p->mLengthBeat >= mStartBeat;
+}
+
+void PrimitiveRangeFilter::updateBeatWindow(const bool force) {
+  int startBeat = 0;
+  int endBeat = 0;
+  if (mBeats) {
+    // a primitive over beats [p, p + l) covers frames [F(p), F(p + l)) and
+    // intersects the window if F(p) < end frame and F(p + l) > start frame
+    const std::vector<int>& frames = mBeats->getFrames();
+    startBeat = static_cast<int>(
+        std::upper_bound(frames.begin(), frames.end(), mStartFrame) -
+        frames.begin());
+    endBeat = static_cast<int>(
+        std::lower_bound(frames.begin(), frames.end(), mEndFrame) -
+        frames.begin());
+  }
+  if (!force && startBeat == mStartBeat && endBeat == mEndBeat) {
+    return;
+  }
+  mStartBeat = startBeat;
+  mEndBeat = endBeat;
+  invalidateFilter();
+}
+
+void PrimitiveRangeFilter::scheduleInvalidate(void) {
+  if (mInvalidatePending) {
+    return;
+  }
+  mInvalidatePending = true;
+  QTimer::singleShot(0, this, [this]() {
+    mInvalidatePending = false;
+    invalidateFilter();
+  });
+}
+
+void PrimitiveRangeFilter::handleRowsAboutToBeRemoved(const QModelIndex& parent,
+                                                      const int first,
+                                                      const int last) {
+  Q_UNUSED(parent);
+  const QList<QObject*>& data = mPrimitives->getData();
+  for (int i = first; i <= last && i < data.size(); ++i) {
+    mPinned.remove(data.at(i));
+  }
+}
@@ -0,0 +1,122 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_PRIMITIVE_RANGE_FILTER_H_
+#define SRC_PRIMITIVE_RANGE_FILTER_H_
+
+#include <QPointer>
+#include <QSet>
+#include <QSortFilterProxyModel>
+
+#include "src/beat_model.h"
+#include "src/primitive_list.h"
+
+/** \class PrimitiveRangeFilter
+ * \brief Proxy model of a primitive list that only contains the primitives
+ * intersecting a frame window, such that views only create delegates for the
+ * visible part of the timeline.
+ *
+ * Moving the window only inserts and removes the rows entering and leaving
+ * it. Pinned primitives, e.g. selected ones, are kept regardless of the
+ * window.
+ */
+class PrimitiveRangeFilter : public QSortFilterProxyModel {
+  Q_OBJECT;
+  Q_PROPERTY(PrimitiveList* primitives READ primitives WRITE setPrimitives
+                 NOTIFY primitivesChanged);
+  Q_PROPERTY(BeatModel* beats READ beats WRITE setBeats NOTIFY beatsChanged);
+  Q_PROPERTY(qreal startFrame READ startFrame WRITE setStartFrame NOTIFY
+                 startFrameChanged);
+  Q_PROPERTY(
+      qreal endFrame READ endFrame WRITE setEndFrame NOTIFY endFrameChanged);
+
+ public:
+  explicit PrimitiveRangeFilter(QObject* parent = nullptr);
+
+  PrimitiveList* primitives(void) const { return mPrimitives; }
+  BeatModel* beats(void) const { return mBeats; }
+  qreal startFrame(void) const { return mStartFrame; }
+  qreal endFrame(void) const { return mEndFrame; }
+
+  /**
+   * \brief Set the primitive list to filter
+   */
+  void setPrimitives(PrimitiveList* primitives);
+
+  /**
+   * \brief Set the beats to map the primitives' beat ranges to frames with
+   */
+  void setBeats(BeatModel* beats);
+
+  void setStartFrame(const qreal startFrame);
+  void setEndFrame(const qreal endFrame);
+
+  /**
+   * \brief Keep a primitive in the model even if it is outside of the window
+   *
+   * \param[in] primitive - primitive of the filtered list
+   * \param[in] pinned - keep (true) or filter again (false)
+   */
+  Q_INVOKABLE void setPinned(QObject* primitive, const bool pinned);
+
+  // NOLINTNEXTLINE
+ signals:
+  void primitivesChanged(void);
+  void beatsChanged(void);
+  void startFrameChanged(void);
+  void endFrameChanged(void);
+
+ protected:
+  bool filterAcceptsRow(int sourceRow,
+                        const QModelIndex& sourceParent) const override;
+
+ private:
+  QPointer<PrimitiveList> mPrimitives;
+  QPointer<BeatModel> mBeats;
+  qreal mStartFrame{0.0};
+  qreal mEndFrame{0.0};
+  QSet<const QObject*> mPinned;
+
+  // window in beats: primitives starting before the end beat and ending at or
+  // after the start beat intersect the frame window
+  int mStartBeat{0};
+  int mEndBeat{0};
+  bool mInvalidatePending{false};
+
+  /**
+   * \brief Map the frame window to beats and filter again if they changed
+   *
+   * \param[in] force - filter again even if the beats did not change
+   */
+  void updateBeatWindow(const bool force);
+
+  /**
+   * \brief Filter again once control returns to the event loop. Used for
+   * changes that may originate from a delegate that would be removed.
+   */
+  void scheduleInvalidate(void);
+
+  /**
+   * \brief Stop pinning primitives that are about to be removed from the list
+   */
+  void handleRowsAboutToBeRemoved(const QModelIndex& parent, const int first,
+                                  const int last);
+};
+
+#endif  // SRC_PRIMITIVE_RANGE_FILTER_H_
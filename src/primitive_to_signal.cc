@@ -19,9 +19,10 @@
 
 #include "src/primitive_to_signal.h"
 
+#include <QtConcurrent>
+
 #include <algorithm>
 #include <cmath>
-#include <random>
 
 PrimitiveToSignal::PrimitiveToSignal(const std::vector<int>& beatFrames,
                                      AudioFile* audioFile,
@@ -31,16 +32,90 @@ PrimitiveToSignal::PrimitiveToSignal(const std::vector<int>& beatFrames,
       mBitTimeZeroUS{bitTimeZeroUS} {
   // initialize other bit timings based on zero time
   updateBitTimings();
-  mCommandLevel = mDataLevel;
 };
 
 const double PrimitiveToSignal::pi{3.14159265358979323846};
 
-void PrimitiveToSignal::generateRandomLed(void) {
-  static std::default_random_engine gen;
-  static std::uniform_int_distribution<int> dist(0, 255u);
+namespace {
+// number of beats generated by one task of the thread pool
+const size_t beatsPerChunk{16};
+
+// Sort primitives by position, unless they are sorted already, as provided
+// by PrimitiveList::getSortedData
+template <class T>
+QList<QObject*> sortByPosition(const QList<QObject*>& primitives) {
+  auto isBefore = [](const QObject* const a, const QObject* const b) {
+    return reinterpret_cast<const T*>(a)->mPositionBeat <
+           reinterpret_cast<const T*>(b)->mPositionBeat;
+  };
+  if (std::is_sorted(primitives.begin(), primitives.end(), isBefore)) {
+    return primitives;
+  }
+  QList<QObject*> sorted = primitives;
+  std::sort(sorted.begin(), sorted.end(), isBefore);
+  return sorted;
+}
+
+// Cursor over primitives sorted by position, returning the primitive active
+// at increasing beats. Primitives are not expected to overlap, and primitives
+// of zero length are skipped.
+template <class T>
+class PrimitiveCursor {
+ public:
+  PrimitiveCursor(const QList<QObject*>& primitives, const size_t startBeat)
+      : mPrimitives{primitives} {
+    // skip the primitives starting before the start beat, except for the
+    // last, which may still be active:
+    auto it = std::upper_bound(
+        mPrimitives.begin(), mPrimitives.end(), static_cast<int>(startBeat),
+        [](const int beat, const QObject* const qo) {
+          return beat < reinterpret_cast<const T*>(qo)->mPositionBeat;
+        });
+    mNext = static_cast<int>(it - mPrimitives.begin());
+    for (int i = mNext - 1; i >= 0 && !mCurrent; --i) {
+      const T* const primitive = reinterpret_cast<const T*>(mPrimitives[i]);
+      if (primitive->mLengthBeat > 0) {
+        mCurrent = primitive;
+      }
+    }
+  }
+
+  // get primitive active at beat, which must not decrease from call to call
+  const T* at(const size_t beat) {
+    const int beatInt = static_cast<int>(beat);
+    while (mNext < mPrimitives.size()) {
+      const T* const primitive = reinterpret_cast<const T*>(mPrimitives[mNext]);
+      if (primitive->mPositionBeat > beatInt) {
+        break;
+      }
+      if (primitive->mLengthBeat > 0) {
+        mCurrent = primitive;
+      }
+      ++mNext;
+    }
+    if (mCurrent && beatInt >= mCurrent->mPositionBeat &&
+        beatInt < mCurrent->mPositionBeat + mCurrent->mLengthBeat) {
+      return mCurrent;
+    }
+    return nullptr;
+  }
+
+ private:
+  const QList<QObject*>& mPrimitives;
+  const T* mCurrent{nullptr};
+  int mNext{0};
+};
+}  // namespace
 
-  mRandomLed = static_cast<quint8>(dist(gen));
+quint8 PrimitiveToSignal::generateRandomLed(const quint32 seed,
+                                           const quint32 period) {
+  // splitmix64 finalizer on the concatenated seed and period:
+  quint64 x = (static_cast<quint64>(seed) << 32) | period;
+  x += 0x9E3779B97F4A7C15ull;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+  x = x ^ (x >> 31);
+  return static_cast<quint8>(x >> 56);
 }
 
 void PrimitiveToSignal::updateBitTimings(void) {
@@ -56,105 +131,342 @@ void PrimitiveToSignal::updateBitTimings(void) {
 
 void PrimitiveToSignal::convert(const QList<QObject*>& motorPrimitives,
                                 const QList<QObject*>& ledPrimitives) {
-  // first, create an array of primitive pointers to have a straightforward map
-  // between beats and primitives:
-  std::vector<const MotorPrimitive*> motorPrimitiveMap(mBeatFrames.size() - 1,
-                                                       nullptr);
-  std::vector<const LEDPrimitive*> ledPrimitiveMap(mBeatFrames.size() - 1,
-                                                   nullptr);
-
-  for (const QObject* const qo : motorPrimitives) {
-    const MotorPrimitive* const mp =
-        reinterpret_cast<const MotorPrimitive*>(qo);
-    size_t start = mp->mPositionBeat;
-    size_t end = start + mp->mLengthBeat;
-    for (size_t i = mp->mPositionBeat; i < end; ++i) {
-      motorPrimitiveMap[i] = mp;
-    }
+  convert(motorPrimitives, ledPrimitives, 0u, mBeatFrames.size() - 1);
+}
+
+void PrimitiveToSignal::convert(const QList<QObject*>& motorPrimitives,
+                                const QList<QObject*>& ledPrimitives,
+                                size_t startBeat, size_t endBeat) {
+  QMutexLocker locker(&mGenerateMutex);
+  if (!prepareBeatRange(&startBeat, &endBeat)) {
+    return;
   }
+  generateBeatRange(motorPrimitives, ledPrimitives, startBeat, endBeat);
+  synthesize(startBeat, endBeat);
+}
 
-  for (const QObject* const qo : ledPrimitives) {
-    const LEDPrimitive* const lp = reinterpret_cast<const LEDPrimitive*>(qo);
-    size_t start = lp->mPositionBeat;
-    size_t end = start + lp->mLengthBeat;
-    for (size_t i = lp->mPositionBeat; i < end; ++i) {
-      ledPrimitiveMap[i] = lp;
-    }
+bool PrimitiveToSignal::prepareBeatRange(size_t* startBeat, size_t* endBeat) {
+  QMutexLocker locker(&mMutex);
+  const size_t nBeats = mBeatFrames.size() - 1;
+  // the rest of the commands can only be kept if they were generated before:
+  if (mBeatStartLevels.size() != nBeats) {
+    mBeatStartLevels.assign(nBeats, mDataLevel);
+    mCommandStream.clear();
+    *startBeat = 0u;
+    *endBeat = nBeats;
+  }
+  *endBeat = std::min(*endBeat, nBeats);
+  return *startBeat < *endBeat;
+}
+
+void PrimitiveToSignal::generateCommands(
+    const QList<QObject*>& motorPrimitives,
+    const QList<QObject*>& ledPrimitives, size_t startBeat, size_t endBeat) {
+  QMutexLocker locker(&mGenerateMutex);
+  if (!prepareBeatRange(&startBeat, &endBeat)) {
+    return;
   }
+  generateBeatRange(motorPrimitives, ledPrimitives, startBeat, endBeat);
+}
 
+void PrimitiveToSignal::generateBeatRange(
+    const QList<QObject*>& motorPrimitives,
+    const QList<QObject*>& ledPrimitives, const size_t startBeat,
+    const size_t endBeat) {
   // prepare some primitive variables:
   mKnightRiderByte = 0u;
   for (size_t i = 0; i < mNknightRiderLeds; ++i) {
     mKnightRiderByte |= (1u << i);
   }
   mKnightRiderAmplitude = (8.0 - mNknightRiderLeds) / 2.0;
-  mLastRandomLEDPrimitive = nullptr;
 
-  // reset the data level and prepare the command buffer:
-  mCommandLevel = mDataLevel;
-  mCommandBuffer.resize(mNresetSamples + 24 * mNoneSamples);
+  const QList<QObject*> sortedMotorPrimitives =
+      sortByPosition<MotorPrimitive>(motorPrimitives);
+  const QList<QObject*> sortedLedPrimitives =
+      sortByPosition<LEDPrimitive>(ledPrimitives);
+
+  // Split the beats into chunks, and reserve as many commands for each chunk
+  // as commands of zero bits, the shortest ones, fit in:
+  const size_t minCommandLength = mNresetSamples + 24 * mNzeroSamples;
+  std::vector<BeatChunk> chunks;
+  size_t nSlots = 0;
+  for (size_t beat = startBeat; beat < endBeat; beat += beatsPerChunk) {
+    BeatChunk chunk;
+    chunk.startBeat = beat;
+    chunk.endBeat = std::min(beat + beatsPerChunk, endBeat);
+    chunk.firstSlot = nSlots;
+    nSlots += (mBeatFrames[chunk.endBeat] - mBeatFrames[chunk.startBeat]) /
+              minCommandLength;
+    chunks.push_back(chunk);
+  }
+
+  // The chunks only depend on each other by the signal level they start at.
+  // So generate them in parallel into buffers of their own, starting at the
+  // positive level, while the stream stays available for playback:
+  std::vector<CommandStream::Command> reserved(nSlots);
+  std::vector<float> beatStartLevels(endBeat - startBeat);
+  QtConcurrent::blockingMap(chunks, [&](BeatChunk& chunk) {
+    generateChunk(sortedMotorPrimitives, sortedLedPrimitives, reserved.data(),
+                  beatStartLevels.data() + (chunk.startBeat - startBeat),
+                  &chunk);
+  });
+  size_t nCommands = 0;
+  for (const BeatChunk& chunk : chunks) {
+    std::copy(reserved.begin() + chunk.firstSlot,
+              reserved.begin() + chunk.firstSlot + chunk.nCommands,
+              reserved.begin() + nCommands);
+    nCommands += chunk.nCommands;
+  }
+
+  // then swap the commands in, and invert the levels of the chunks actually
+  // starting at the negative level:
+  QMutexLocker locker(&mMutex);
+  float level = mBeatStartLevels[startBeat];
+  for (const BeatChunk& chunk : chunks) {
+    const bool invert = level != mDataLevel;
+    for (size_t i = chunk.startBeat; i < chunk.endBeat; ++i) {
+      const float relativeLevel = beatStartLevels[i - startBeat];
+      mBeatStartLevels[i] = invert ? -relativeLevel : relativeLevel;
+    }
+    level = invert ? -chunk.endLevel : chunk.endLevel;
+  }
+  CommandStream::Command* const commands = mCommandStream.replace(
+      static_cast<quint32>(mBeatFrames[startBeat]),
+      static_cast<quint32>(mBeatFrames[endBeat]), nCommands);
+  std::copy(reserved.begin(), reserved.begin() + nCommands, commands);
+}
+
+void PrimitiveToSignal::generateChunk(const QList<QObject*>& motorPrimitives,
+                                      const QList<QObject*>& ledPrimitives,
+                                      CommandStream::Command* const reserved,
+                                      float* const beatStartLevels,
+                                      BeatChunk* const chunk) {
+  // walk the beats along with the primitives to find the primitives active at
+  // each beat, and keep track of the signal level at the start of each beat.
+  // It toggles with every command, and with the fill after the last command of
+  // a beat unless the fill is very short.
+  PrimitiveCursor<MotorPrimitive> motorCursor(motorPrimitives,
+                                              chunk->startBeat);
+  PrimitiveCursor<LEDPrimitive> ledCursor(ledPrimitives, chunk->startBeat);
+  CommandStream::Command* const commands = reserved + chunk->firstSlot;
+  float level = mDataLevel;
+  for (size_t i = chunk->startBeat; i < chunk->endBeat; ++i) {
+    beatStartLevels[i - chunk->startBeat] = level;
+    const size_t nBeatCommands =
+        generateBeatCommands(i, motorCursor.at(i), ledCursor.at(i),
+                             commands + chunk->nCommands);
+    size_t fillFrame = mBeatFrames[i];
+    if (nBeatCommands > 0) {
+      const CommandStream::Command& last =
+          commands[chunk->nCommands + nBeatCommands - 1];
+      fillFrame = last.frame + getCommandLength(last);
+    }
+    chunk->nCommands += nBeatCommands;
+    if (nBeatCommands % 2) {
+      level = -level;
+    }
+    if (mBeatFrames[i + 1] - fillFrame >= mNzeroSamples / 2) {
+      level = -level;
+    }
+  }
+  chunk->endLevel = level;
+}
+
+void PrimitiveToSignal::synthesize(size_t startBeat, size_t endBeat) {
+  // write from a snapshot, such that blocks can be synthesized for playback
+  // and commands be generated meanwhile
+  CommandStream commandStream;
+  std::vector<float> beatStartLevels;
+  {
+    QMutexLocker locker(&mMutex);
+    commandStream = mCommandStream;
+    beatStartLevels = mBeatStartLevels;
+  }
+  endBeat = std::min(endBeat, beatStartLevels.size());
+  if (startBeat >= endBeat) {
+    return;
+  }
+
+  // the start level of every beat is known, so write them in parallel
+  std::vector<size_t> beats(endBeat - startBeat);
+  for (size_t i = 0; i < beats.size(); ++i) {
+    beats[i] = startBeat + i;
+  }
+  SignalWindow window;
+  window.signal = mAudioFile->mFloatData.data();
+  window.endFrame = mAudioFile->mFloatData.size();
+  QtConcurrent::blockingMap(beats, [&](const size_t& beat) {
+    synthesizeBeat(beat, commandStream, beatStartLevels, window);
+  });
+}
+
+void PrimitiveToSignal::synthesizeFrames(const size_t startFrame,
+                                         const size_t nFrames,
+                                         float* const signal) const {
+  std::fill(signal, signal + nFrames, 0.0f);
 
-  // now iterate through all beats, processing the primitives at the given beat
-  for (size_t i = 0; i < mBeatFrames.size() - 1; ++i) {
-    processPrimitivesAtBeat(i, motorPrimitiveMap[i], ledPrimitiveMap[i]);
+  QMutexLocker locker(&mMutex);
+  if (mBeatStartLevels.empty()) {
+    return;
   }
+  SignalWindow window;
+  window.signal = signal;
+  window.startFrame = startFrame;
+  window.endFrame = startFrame + nFrames;
 
-  // Done!
+  // find first beat overlapping the block, and write beats until the end of
+  // the block:
+  auto it = std::upper_bound(mBeatFrames.begin(), mBeatFrames.end(),
+                             static_cast<int>(startFrame));
+  size_t beat = it == mBeatFrames.begin()
+                    ? 0
+                    : static_cast<size_t>(it - mBeatFrames.begin()) - 1;
+  for (; beat < mBeatStartLevels.size() &&
+         static_cast<size_t>(mBeatFrames[beat]) < window.endFrame;
+       ++beat) {
+    synthesizeBeat(beat, mCommandStream, mBeatStartLevels, window);
+  }
 }
 
-void PrimitiveToSignal::processPrimitivesAtBeat(
+size_t PrimitiveToSignal::generateBeatCommands(
     const size_t currentBeat, const MotorPrimitive* const motorPrimitive,
-    const LEDPrimitive* const ledPrimitive) {
-  // init current and final frame, and their difference
+    const LEDPrimitive* const ledPrimitive,
+    CommandStream::Command* const commands) const {
   const size_t startFrame = mBeatFrames[currentBeat];
   const size_t endFrame = mBeatFrames[currentBeat + 1];
-  const size_t nFrames = endFrame - startFrame;
   size_t currentFrame = startFrame;
+  size_t nCommands = 0;
+
+  if (isConstant(motorPrimitive) && isConstant(ledPrimitive)) {
+    // all commands of the beat are identical, so evaluate the primitives once
+    // and only place the commands:
+    CommandStream::Command command = evaluateCommand(
+        currentBeat, currentFrame, motorPrimitive, ledPrimitive);
+    const size_t commandLength = getCommandLength(command);
+    while (commandLength + currentFrame < endFrame) {
+      command.frame = static_cast<quint32>(currentFrame);
+      commands[nCommands++] = command;
+      currentFrame += commandLength;
+    }
+    return nCommands;
+  }
 
   // go through all beat frames
   while (currentFrame < endFrame) {
-    // struct to write velocities and leds to
-    Data data;
-    // current beat fraction based on current frame
-    double beatFraction =
-        static_cast<double>(currentFrame - startFrame) / nFrames;
-
-    // get motor velocities, if there is a motor primitive:
-    if (motorPrimitive) {
-      double relativeBeat =
-          (currentBeat - motorPrimitive->mPositionBeat) + beatFraction;
-      getMotorVelocities(relativeBeat, motorPrimitive, &data);
+    const CommandStream::Command command = evaluateCommand(
+        currentBeat, currentFrame, motorPrimitive, ledPrimitive);
+    const size_t commandLength = getCommandLength(command);
+    if (commandLength + currentFrame >= endFrame) {
+      // not enough space to write command, the rest of the beat is filled
+      break;
     }
+    commands[nCommands++] = command;
+    currentFrame += commandLength;
+  }
+  return nCommands;
+}
 
-    if (ledPrimitive) {
-      double relativeBeat =
-          (currentBeat - ledPrimitive->mPositionBeat) + beatFraction;
-      getLEDs(relativeBeat, ledPrimitive, &data);
-    }
-    float tempCommandLevel = mCommandLevel;
-    size_t commandLength = generateCommand(&data);
-    if (commandLength + currentFrame < endFrame) {
-      // the command fits, write to audio data:
-      std::copy(mCommandBuffer.begin(), mCommandBuffer.begin() + commandLength,
-                mAudioFile->mFloatData.begin() + currentFrame);
-      currentFrame += commandLength;
+bool PrimitiveToSignal::isConstant(const MotorPrimitive* const motorPrimitive) {
+  return !motorPrimitive ||
+         (motorPrimitive->mType != MotorPrimitive::Type::BackAndForth &&
+          motorPrimitive->mType != MotorPrimitive::Type::Twist);
+}
+
+bool PrimitiveToSignal::isConstant(const LEDPrimitive* const ledPrimitive) {
+  return !ledPrimitive || ledPrimitive->mType == LEDPrimitive::Type::Constant;
+}
+
+CommandStream::Command PrimitiveToSignal::evaluateCommand(
+    const size_t currentBeat, const size_t currentFrame,
+    const MotorPrimitive* const motorPrimitive,
+    const LEDPrimitive* const ledPrimitive) const {
+  const size_t startFrame = mBeatFrames[currentBeat];
+  const size_t nFrames = mBeatFrames[currentBeat + 1] - startFrame;
+
+  // struct to write velocities and leds to
+  Data data;
+  // current beat fraction based on current frame
+  double beatFraction =
+      static_cast<double>(currentFrame - startFrame) / nFrames;
+
+  // get motor velocities, if there is a motor primitive:
+  if (motorPrimitive) {
+    double relativeBeat =
+        (currentBeat - motorPrimitive->mPositionBeat) + beatFraction;
+    getMotorVelocities(relativeBeat, motorPrimitive, &data);
+  }
+
+  if (ledPrimitive) {
+    double relativeBeat =
+        (currentBeat - ledPrimitive->mPositionBeat) + beatFraction;
+    getLEDs(relativeBeat, ledPrimitive, &data);
+  }
+
+  CommandStream::Command command;
+  command.frame = static_cast<quint32>(currentFrame);
+  command.velocityLeft = velocityToByte(data.velocityLeft);
+  command.velocityRight = velocityToByte(data.velocityRight);
+  command.leds = data.leds;
+  return command;
+}
+
+void PrimitiveToSignal::synthesizeBeat(
+    const size_t currentBeat, const CommandStream& commandStream,
+    const std::vector<float>& beatStartLevels,
+    const SignalWindow& window) const {
+  const size_t startFrame = mBeatFrames[currentBeat];
+  const size_t endFrame = mBeatFrames[currentBeat + 1];
+  size_t first = 0;
+  size_t last = 0;
+  commandStream.findRange(static_cast<quint32>(startFrame),
+                          static_cast<quint32>(endFrame), &first, &last);
+
+  // write the commands, the level toggles an odd number of times per command:
+  const std::vector<CommandStream::Command>& commands =
+      commandStream.getCommands();
+  float commandLevel = beatStartLevels[currentBeat];
+  size_t currentFrame = startFrame;
+  for (size_t i = first; i < last; ++i) {
+    currentFrame =
+        commands[i].frame + writeCommand(commands[i], commandLevel, window);
+    commandLevel = -commandLevel;
+  }
+
+  // Fill the rest of the beat. Either write an additional zero or not,
+  // depending on distance to next beat:
+  const size_t nFillFrames = endFrame - currentFrame;
+  if (nFillFrames < mNzeroSamples / 2) {
+    // do not toggle level but let next reset pulse finish off last command
+    // of this beat
+    commandLevel = -commandLevel;
+  }
+  if (currentBeat + 1 < beatStartLevels.size() &&
+      commandLevel == beatStartLevels[currentBeat + 1]) {
+    // the next beat was not re-rendered along with this one and starts at the
+    // fill level, so its reset pulse would not be detected. Add an edge after
+    // the last complete command instead:
+    if (nFillFrames < mNzeroSamples / 2) {
+      // end the last command on time and fill with a short pulse
+      commandLevel = -commandLevel;
     } else {
-      // not enough space to write command. Restore command level to last:
-      mCommandLevel = tempCommandLevel;
-      // Either write an additional zero or not, depending on
-      // distance to next beat:
-      if (endFrame - currentFrame < mNzeroSamples / 2) {
-        // do not toggle level but let next reset pulse finish off last command
-        // of this beat
-        mCommandLevel = -mCommandLevel;
-      }
-      for (size_t i = currentFrame; i < endFrame; ++i) {
-        mAudioFile->mFloatData[i] = mCommandLevel;
-      }
-      currentFrame = endFrame;
-      mCommandLevel = -mCommandLevel;
+      // split the fill into two pulses
+      const size_t splitFrame = currentFrame + nFillFrames / 2;
+      fill(currentFrame, splitFrame, commandLevel, window);
+      currentFrame = splitFrame;
+      commandLevel = -commandLevel;
     }
   }
+  fill(currentFrame, endFrame, commandLevel, window);
+}
+
+void PrimitiveToSignal::fill(const size_t startFrame, const size_t endFrame,
+                             const float level, const SignalWindow& window) {
+  const size_t start = std::max(startFrame, window.startFrame);
+  const size_t end = std::min(endFrame, window.endFrame);
+  if (start < end) {
+    std::fill(window.signal + (start - window.startFrame),
+              window.signal + (end - window.startFrame), level);
+  }
 }
 
 void PrimitiveToSignal::getMotorVelocities(
@@ -163,8 +475,8 @@ void PrimitiveToSignal::getMotorVelocities(
   switch (motorPrimitive->mType) {
     case MotorPrimitive::Type::BackAndForth: {
       double angle = relativeBeat * motorPrimitive->mFrequency * 2.0 * pi;
-      data->velocityLeft =
-          static_cast<qint8>(round(motorPrimitive->mVelocity * sin(angle)));
+      data->velocityLeft = static_cast<qint8>(
+          std::round(motorPrimitive->mVelocity * std::sin(angle)));
       data->velocityRight = data->velocityLeft;
       break;
     }
@@ -182,8 +494,8 @@ void PrimitiveToSignal::getMotorVelocities(
       break;
     case MotorPrimitive::Type::Twist: {
       double angle = relativeBeat * motorPrimitive->mFrequency * 2.0 * pi;
-      data->velocityLeft =
-          static_cast<qint8>(-round(motorPrimitive->mVelocity * sin(angle)));
+      data->velocityLeft = static_cast<qint8>(
+          -std::round(motorPrimitive->mVelocity * std::sin(angle)));
       data->velocityRight = -data->velocityLeft;
       break;
     }
@@ -192,7 +504,7 @@ void PrimitiveToSignal::getMotorVelocities(
 
 void PrimitiveToSignal::getLEDs(const double relativeBeat,
                                 const LEDPrimitive* const ledPrimitive,
-                                Data* data) {
+                                Data* data) const {
   switch (ledPrimitive->mType) {
     case LEDPrimitive::Type::Alternate: {
       quint32 period =
@@ -222,58 +534,62 @@ void PrimitiveToSignal::getLEDs(const double relativeBeat,
     case LEDPrimitive::Type::KnightRider: {
       double angle = ledPrimitive->mFrequency * relativeBeat * 2.0 * pi;
       quint8 pos = static_cast<quint8>(
-          round(mKnightRiderAmplitude * (1.0 + sin(angle))));
+          std::round(mKnightRiderAmplitude * (1.0 + std::sin(angle))));
       data->leds = mKnightRiderByte << pos;
       break;
     }
     case LEDPrimitive::Type::Random: {
-      // check if new primitive is active:
-      if (mLastRandomLEDPrimitive != ledPrimitive) {
-        mLastRandomLedPeriod = -1;
-        mLastRandomLEDPrimitive = ledPrimitive;
-      }
-      // get current period
-      int period = static_cast<int>(relativeBeat * ledPrimitive->mFrequency);
-
-      if (period != mLastRandomLedPeriod) {
-        generateRandomLed();
-        mLastRandomLedPeriod = period;
-      }
-
-      data->leds = mRandomLed;
+      quint32 period =
+          static_cast<quint32>(relativeBeat * ledPrimitive->mFrequency);
+      data->leds = generateRandomLed(ledPrimitive->mSeed, period);
       break;
     }
   }
 }
 
-size_t PrimitiveToSignal::generateCommand(const Data* const data) {
-  size_t length = mNresetSamples;
-  for (size_t i = 0; i < mNresetSamples; ++i) {
-    mCommandBuffer[i] = mCommandLevel;
+size_t PrimitiveToSignal::getCommandLength(
+    const CommandStream::Command& command) const {
+  // count one bits of the three command bytes:
+  const quint32 bits = command.velocityLeft | (command.velocityRight << 8) |
+                       (static_cast<quint32>(command.leds) << 16);
+  size_t nOnes = 0;
+  for (int i = 0; i < 24; ++i) {
+    nOnes += (bits >> i) & 1u;
   }
-  // flip command level
-  mCommandLevel = -mCommandLevel;
+  return mNresetSamples + nOnes * mNoneSamples + (24 - nOnes) * mNzeroSamples;
+}
 
-  quint8 leftVelByte = velocityToByte(data->velocityLeft);
-  quint8 rightVelByte = velocityToByte(data->velocityRight);
+size_t PrimitiveToSignal::writeCommand(const CommandStream::Command& command,
+                                       float level,
+                                       const SignalWindow& window) const {
+  const size_t frame = command.frame;
+  if (frame >= window.endFrame ||
+      frame + getCommandLength(command) <= window.startFrame) {
+    // command is outside of the window, skip writing
+    return getCommandLength(command);
+  }
 
-  length += writeByteToBuffer(leftVelByte, length);
-  length += writeByteToBuffer(rightVelByte, length);
-  length += writeByteToBuffer(data->leds, length);
+  size_t length = mNresetSamples;
+  fill(frame, frame + mNresetSamples, level, window);
+  // flip command level
+  level = -level;
+
+  length += writeByte(command.velocityLeft, frame + length, &level, window);
+  length += writeByte(command.velocityRight, frame + length, &level, window);
+  length += writeByte(command.leds, frame + length, &level, window);
   return length;
 }
 
-size_t PrimitiveToSignal::writeByteToBuffer(const quint8 byte,
-                                            const size_t offset) {
+size_t PrimitiveToSignal::writeByte(const quint8 byte, const size_t frame,
+                                    float* const level,
+                                    const SignalWindow& window) const {
   size_t length = 0;
 
   for (int i = 0; i < 8; ++i) {
     const size_t nFrameWrite = byte & (1u << i) ? mNoneSamples : mNzeroSamples;
-    for (size_t j = 0; j < nFrameWrite; ++j) {
-      mCommandBuffer[j + offset + length] = mCommandLevel;
-    }
+    fill(frame + length, frame + length + nFrameWrite, *level, window);
     length += nFrameWrite;
-    mCommandLevel = -mCommandLevel;
+    *level = -*level;
   }
   return length;
 }
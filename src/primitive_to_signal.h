@@ -20,14 +20,20 @@
 #ifndef SRC_PRIMITIVE_TO_SIGNAL_H_
 #define SRC_PRIMITIVE_TO_SIGNAL_H_
 
+#include <QMutex>
 #include <vector>
 
 #include "src/audio_file.h"
+#include "src/command_stream.h"
 #include "src/primitive.h"
 
 /** \class PrimitiveToSignal
  * \brief Converts motor and led primitives to data audio signal for Dancebot
  * to parse.
+ *
+ * The conversion is done in two steps: The primitives are first evaluated to a
+ * command stream, i.e. a list of timed commands, which is then synthesized to
+ * the data signal. The public methods may be called from different threads.
  */
 class PrimitiveToSignal {
  public:
@@ -43,14 +49,82 @@ class PrimitiveToSignal {
                              const size_t bitTimeZeroUS = 181u);
 
   /**
-   * \brief Converts primitives to data signal
+   * \brief Converts primitives to data signal. The beats are written in
+   * parallel on the global thread pool.
    *
-   * \param[in] motorPrimitives - motor primitives to process
-   * \param[in] ledPrimitives - led primitives to process
+   * \param[in] motorPrimitives - motor primitives to process, preferably
+   * sorted by position, which saves sorting them
+   * \param[in] ledPrimitives - led primitives to process, preferably sorted
    */
   void convert(const QList<QObject*>& motorPrimitives,
                const QList<QObject*>& ledPrimitives);
 
+  /**
+   * \brief Converts primitives to data signal for a range of beats only,
+   * keeping the signal of the other beats as rendered by previous calls. The
+   * end of the range is joined to the following beat such that the signal
+   * level alternates correctly across the range boundary.
+   *
+   * If no commands have been generated yet by this converter, all beats
+   * are converted.
+   *
+   * \param[in] motorPrimitives - motor primitives to process, preferably
+   * sorted by position, which saves sorting them
+   * \param[in] ledPrimitives - led primitives to process, preferably sorted
+   * \param[in] startBeat - first beat to convert
+   * \param[in] endBeat - one beyond the last beat to convert
+   */
+  void convert(const QList<QObject*>& motorPrimitives,
+               const QList<QObject*>& ledPrimitives, size_t startBeat,
+               size_t endBeat);
+
+  /**
+   * \brief Evaluates the primitives of a range of beats and replaces the
+   * commands of these beats in the command stream. Does not write the data
+   * signal. Chunks of beats are evaluated in parallel on the global thread
+   * pool.
+   *
+   * If no commands have been generated yet by this converter, all beats
+   * are evaluated.
+   *
+   * \param[in] motorPrimitives - motor primitives to process, preferably
+   * sorted by position, which saves sorting them
+   * \param[in] ledPrimitives - led primitives to process, preferably sorted
+   * \param[in] startBeat - first beat to evaluate
+   * \param[in] endBeat - one beyond the last beat to evaluate
+   */
+  void generateCommands(const QList<QObject*>& motorPrimitives,
+                        const QList<QObject*>& ledPrimitives,
+                        size_t startBeat, size_t endBeat);
+
+  /**
+   * \brief Writes the data signal of a range of beats from a snapshot of the
+   * command stream, such that synthesizeFrames and generateCommands are not
+   * blocked meanwhile. The beats are written in parallel on the global thread
+   * pool.
+   *
+   * \param[in] startBeat - first beat to write
+   * \param[in] endBeat - one beyond the last beat to write
+   */
+  void synthesize(size_t startBeat, size_t endBeat);
+
+  /**
+   * \brief Writes the data signal of a block of frames from the command stream
+   * to a separate buffer, e.g. for real-time playback. Frames outside of the
+   * beats are set to zero.
+   *
+   * \param[in] startFrame - first frame of the block
+   * \param[in] nFrames - number of frames in the block
+   * \param[out] signal - buffer of at least nFrames to write the block to
+   */
+  void synthesizeFrames(const size_t startFrame, const size_t nFrames,
+                        float* const signal) const;
+
+  /**
+   * \brief Get the command stream generated from the primitives
+   */
+  const CommandStream& getCommandStream(void) const { return mCommandStream; }
+
  private:
   // CONSTANTS
   // default values if there is no primitive at a given beat
@@ -65,6 +139,26 @@ class PrimitiveToSignal {
     quint8 leds{defaultLEDs};
   };
 
+  // Block of the data signal in absolute frames [startFrame, endFrame), where
+  // signal points to the data of startFrame. Writes outside of the block are
+  // discarded.
+  struct SignalWindow {
+    float* signal{nullptr};
+    size_t startFrame{0};
+    size_t endFrame{0};
+  };
+
+  // Consecutive beats whose commands are generated by one task. The commands
+  // are written to the stream from its reserved command firstSlot on, and the
+  // beat start levels are relative to a chunk starting at the positive level.
+  struct BeatChunk {
+    size_t startBeat{0};
+    size_t endBeat{0};
+    size_t firstSlot{0};
+    size_t nCommands{0};
+    float endLevel{0.0f};
+  };
+
   // VARIABLES
   // audio and beat data:
   const std::vector<int>& mBeatFrames;
@@ -87,19 +181,31 @@ class PrimitiveToSignal {
   size_t mNoneSamples{0};
   size_t mNresetSamples{0};
 
-  // random led variables to keep track of periods and values
-  const LEDPrimitive* mLastRandomLEDPrimitive{nullptr};
-  int mLastRandomLedPeriod{-1};
-  quint8 mRandomLed{0};
+  // guards command stream and beat start levels, only held to read or swap
+  // them, such that playback is not blocked by rendering
+  mutable QMutex mMutex;
+
+  // serializes command generation, which uses the knight rider variables
+  QMutex mGenerateMutex;
 
-  // command buffer and variable to keep track of command signal level
-  std::vector<float> mCommandBuffer;
-  float mCommandLevel;
+  // commands generated from the primitives
+  CommandStream mCommandStream;
+
+  // signal level at the start of each beat, used to synthesize beats
+  // independently and to join partially re-rendered beat ranges to the rest of
+  // the signal
+  std::vector<float> mBeatStartLevels;
 
   /**
-   * \brief Generate random bits in mRandomLed for random primitive
+   * \brief Generate random led bits for a period of a random primitive. The
+   * bits are a hash of the primitive's seed and the period, such that every
+   * period can be evaluated independently and renders are reproducible.
+   *
+   * \param[in] seed - the seed of the random led primitive
+   * \param[in] period - the period relative to the start of the primitive
+   * \return the led bits
    */
-  void generateRandomLed(void);
+  static quint8 generateRandomLed(const quint32 seed, const quint32 period);
 
   /**
    * \brief Calculate bit timings based on mBitTimeZeroUS and the multiplier
@@ -108,20 +214,111 @@ class PrimitiveToSignal {
   void updateBitTimings(void);
 
   /**
-   * \brief Processes primitives for a single beat, writing the commands to the
-   * audiofile member data signal. Should be called consecutively as it relies
-   * on correct tracking of current data signal level (timings are read out by
-   * edges on the signal so actual levels are not important)
+   * \brief Check if commands were generated, and, if not, extend the range
+   * to all beats. Clamps the range to the available beats. Locks mMutex.
+   *
+   * \param[in, out] startBeat - first beat of range
+   * \param[in, out] endBeat - one beyond the last beat of range
+   * \return whether the range is not empty (true) or empty (false)
+   */
+  bool prepareBeatRange(size_t* startBeat, size_t* endBeat);
+
+  /**
+   * \brief Implementation of generateCommands for a prepared beat range. The
+   * commands are generated into buffers and only swapped into the stream
+   * while holding mMutex.
+   */
+  void generateBeatRange(const QList<QObject*>& motorPrimitives,
+                         const QList<QObject*>& ledPrimitives,
+                         const size_t startBeat, const size_t endBeat);
+
+  /**
+   * \brief Generates the commands of a chunk of beats, and their start levels
+   * relative to the positive level.
+   *
+   * \param[in] motorPrimitives - motor primitives sorted by position
+   * \param[in] ledPrimitives - led primitives sorted by position
+   * \param[out] reserved - commands reserved for the range
+   * \param[out] beatStartLevels - start levels of the chunk's beats
+   * \param[in, out] chunk - the chunk to generate
+   */
+  void generateChunk(const QList<QObject*>& motorPrimitives,
+                     const QList<QObject*>& ledPrimitives,
+                     CommandStream::Command* const reserved,
+                     float* const beatStartLevels, BeatChunk* const chunk);
+
+  /**
+   * \brief Evaluates primitives for a single beat to commands. The commands
+   * are placed back to back from the beat start, as long as they fit before
+   * the next beat. Beats are independent of each other and may be evaluated
+   * in parallel.
    *
    * \param[in] currentBeat - the current beat location
    * \param[in] motorPrimitive - the motor primitive at the current beat, which
    * is active until the next beat. It may be null if there is no primitive set
    * at the beat. In this case, the default values defined above are used.
    * \param[in] ledPrimitive - the led primitive at the current beat.
+   * \param[out] commands - buffer to write the beat's commands to, which has
+   * to hold as many commands of zero bits as fit into the beat
+   * \return the number of commands written
+   */
+  size_t generateBeatCommands(const size_t currentBeat,
+                              const MotorPrimitive* const motorPrimitive,
+                              const LEDPrimitive* const ledPrimitive,
+                              CommandStream::Command* const commands) const;
+
+  /**
+   * \brief Writes the data signal of a single beat from its commands, starting
+   * at the signal level in beatStartLevels. The signal after the last command
+   * is filled such that the next beat's reset pulse starts with an edge
+   * (timings are read out by edges on the signal so actual levels are not
+   * important).
+   *
+   * \param[in] currentBeat - the beat to write
+   * \param[in] commandStream - the commands, e.g. mCommandStream
+   * \param[in] beatStartLevels - the beat start levels, e.g. mBeatStartLevels
+   * \param[in] window - data signal block to write to
    */
-  void processPrimitivesAtBeat(const size_t currentBeat,
-                               const MotorPrimitive* const motorPrimitive,
-                               const LEDPrimitive* const ledPrimitive);
+  void synthesizeBeat(const size_t currentBeat,
+                      const CommandStream& commandStream,
+                      const std::vector<float>& beatStartLevels,
+                      const SignalWindow& window) const;
+
+  /**
+   * \brief Fills a frame range of the data signal with a level, clipped to the
+   * signal window.
+   *
+   * \param[in] startFrame - first frame to fill
+   * \param[in] endFrame - one beyond the last frame to fill
+   * \param[in] level - the signal level
+   * \param[in] window - data signal block to write to
+   */
+  static void fill(const size_t startFrame, const size_t endFrame,
+                   const float level, const SignalWindow& window);
+
+  /**
+   * \brief Check whether the values of a primitive do not change over the
+   * course of a beat, in which case all commands of the beat are identical.
+   * Null primitives are constant.
+   */
+  static bool isConstant(const MotorPrimitive* const motorPrimitive);
+  static bool isConstant(const LEDPrimitive* const ledPrimitive);
+
+  /**
+   * \brief Evaluates the primitives at a given frame of a beat.
+   *
+   * \param[in] currentBeat - the current beat location
+   * \param[in] currentFrame - the frame to evaluate the primitives at
+   * \param[in] motorPrimitive - the motor primitive at the current beat, may
+   * be null
+   * \param[in] ledPrimitive - the led primitive at the current beat, may be
+   * null
+   * \return the command at the given frame
+   */
+  CommandStream::Command evaluateCommand(
+      const size_t currentBeat, const size_t currentFrame,
+      const MotorPrimitive* const motorPrimitive,
+      const LEDPrimitive* const ledPrimitive) const;
 
   /**
    * \brief Calculate current motor velocity based on primitive and current
@@ -146,23 +343,40 @@ class PrimitiveToSignal {
    * \param[in] data - the command data to populate with calculated values
    */
   void getLEDs(const double relativeBeat,
-               const LEDPrimitive* const ledPrimitive, Data* data);
+               const LEDPrimitive* const ledPrimitive, Data* data) const;
+
+  /**
+   * \brief Calculates the length of a command
+   *
+   * \param[in] command - the command
+   * \return The length of the command in audio samples
+   */
+  size_t getCommandLength(const CommandStream::Command& command) const;
+
   /**
-   * \brief Writes given command data to data audio signal buffer
+   * \brief Writes a command to the data signal. The signal level toggles after
+   * the reset pulse and every bit, i.e. the level after the command is the
+   * inverse of the start level.
    *
-   * \param[in] data - the command data to write to the data signal
+   * \param[in] command - the command to write to the data signal
+   * \param[in] level - the signal level of the command's reset pulse
+   * \param[in] window - data signal block to write to
    * \return The length of the command in audio samples
    */
-  size_t generateCommand(const Data* const data);
+  size_t writeCommand(const CommandStream::Command& command, float level,
+                      const SignalWindow& window) const;
 
   /**
-   * \brief Writes a single byte to the command buffer
+   * \brief Writes a single byte to the data signal
    *
    * \param[in] byte - the byte to write
-   * \param[in] offset - the byte # offset in the command buffer
+   * \param[in] frame - the frame to start writing at
+   * \param[in] level - the level of the first bit, toggled after every bit
+   * \param[in] window - data signal block to write to
    * \return length of byte in audio samples
    */
-  size_t writeByteToBuffer(const quint8 byte, const size_t offset);
+  size_t writeByte(const quint8 byte, const size_t frame, float* const level,
+                   const SignalWindow& window) const;
 
   /**
    * \brief Converts a velocity to a byte to write to buffer, where bits 0..6
@@ -0,0 +1,133 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/time_stretcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+TimeStretcher::TimeStretcher(void)
+    : mWindow(frameLength),
+      mTailLeft(hopLength),
+      mTailRight(hopLength),
+      mReadyLeft(hopLength),
+      mReadyRight(hopLength),
+      mSearchLeft(frameLength + 2 * tolerance),
+      mSearchRight(frameLength + 2 * tolerance),
+      mContinuationLeft(hopLength),
+      mContinuationRight(hopLength) {
+  // periodic Hann window, whose halves add up to one at half window overlap
+  const double pi = std::acos(-1.0);
+  for (int i = 0; i < frameLength; ++i) {
+    mWindow[i] =
+        static_cast<float>(0.5 - 0.5 * std::cos(2.0 * pi * i / frameLength));
+  }
+}
+
+void TimeStretcher::reset(const Source& source, const qint64 position,
+                          const double speed) {
+  mSpeed = speed;
+  mPosition = static_cast<double>(position);
+  mAnalysisPos = mPosition;
+
+  // prime the overlap with the frame ending half a window after the position,
+  // such that output starts at full gain:
+  mPreviousStart = position - hopLength;
+  source(mPreviousStart, frameLength, mSearchLeft.data(),
+         mSearchRight.data());
+  for (int i = 0; i < hopLength; ++i) {
+    mTailLeft[i] = mWindow[hopLength + i] * mSearchLeft[hopLength + i];
+    mTailRight[i] = mWindow[hopLength + i] * mSearchRight[hopLength + i];
+  }
+  mReadyIndex = hopLength;
+}
+
+void TimeStretcher::process(const Source& source, const size_t nFrames,
+                            float* left, float* right) {
+  size_t done = 0;
+  while (done < nFrames) {
+    if (mReadyIndex == static_cast<size_t>(hopLength)) {
+      addFrame(source);
+    }
+    const size_t n =
+        std::min(nFrames - done, static_cast<size_t>(hopLength) - mReadyIndex);
+    std::copy_n(mReadyLeft.begin() + mReadyIndex, n, left + done);
+    std::copy_n(mReadyRight.begin() + mReadyIndex, n, right + done);
+    mReadyIndex += n;
+    done += n;
+  }
+  mPosition += mSpeed * static_cast<double>(nFrames);
+}
+
+void TimeStretcher::addFrame(const Source& source) {
+  const qint64 nominalStart = std::llround(mAnalysisPos);
+  const qint64 searchStart = nominalStart - tolerance;
+  source(searchStart, mSearchLeft.size(), mSearchLeft.data(),
+         mSearchRight.data());
+  // natural continuation of the previous frame:
+  source(mPreviousStart + hopLength, hopLength, mContinuationLeft.data(),
+         mContinuationRight.data());
+
+  // normalized cross-correlation with the continuation on the sum of both
+  // channels, coarse search on every other shift and sample, then refine:
+  auto similarity = [&](const int offset) {
+    float correlation = 0.0f;
+    float energy = 1.0e-9f;
+    const float* const candidateLeft = mSearchLeft.data() + offset;
+    const float* const candidateRight = mSearchRight.data() + offset;
+    for (int i = 0; i < hopLength; i += 2) {
+      const float candidate = candidateLeft[i] + candidateRight[i];
+      correlation +=
+          candidate * (mContinuationLeft[i] + mContinuationRight[i]);
+      energy += candidate * candidate;
+    }
+    return correlation / std::sqrt(energy);
+  };
+  int bestOffset = tolerance;
+  float bestSimilarity = similarity(bestOffset);
+  for (int offset = 0; offset <= 2 * tolerance; offset += 2) {
+    const float s = similarity(offset);
+    if (s > bestSimilarity) {
+      bestSimilarity = s;
+      bestOffset = offset;
+    }
+  }
+  const int coarseOffset = bestOffset;
+  for (int offset = std::max(0, coarseOffset - 1);
+       offset <= std::min(2 * tolerance, coarseOffset + 1); ++offset) {
+    const float s = similarity(offset);
+    if (s > bestSimilarity) {
+      bestSimilarity = s;
+      bestOffset = offset;
+    }
+  }
+
+  // overlap-add the windowed frame:
+  const float* const frameLeft = mSearchLeft.data() + bestOffset;
+  const float* const frameRight = mSearchRight.data() + bestOffset;
+  for (int i = 0; i < hopLength; ++i) {
+    mReadyLeft[i] = mTailLeft[i] + mWindow[i] * frameLeft[i];
+    mReadyRight[i] = mTailRight[i] + mWindow[i] * frameRight[i];
+    mTailLeft[i] = mWindow[hopLength + i] * frameLeft[hopLength + i];
+    mTailRight[i] = mWindow[hopLength + i] * frameRight[hopLength + i];
+  }
+  mReadyIndex = 0;
+  mPreviousStart = searchStart + bestOffset;
+  mAnalysisPos += mSpeed * hopLength;
+}
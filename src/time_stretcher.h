@@ -0,0 +1,106 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_TIME_STRETCHER_H_
+#define SRC_TIME_STRETCHER_H_
+
+#include <QtGlobal>
+#include <functional>
+#include <vector>
+
+/** \class TimeStretcher
+ * \brief Streaming WSOLA (waveform similarity overlap-add) time-stretch of
+ * stereo audio, changing the playback speed without changing the pitch.
+ *
+ * Windowed frames of the source are overlap-added at a fixed output hop, and
+ * read at a hop scaled by the speed. Each frame is shifted within a tolerance
+ * to the position that best continues the previous frame, found by
+ * cross-correlation of the sum of both channels. The shift is applied to both
+ * channels, such that the stereo image is kept.
+ */
+class TimeStretcher {
+ public:
+  /**
+   * \brief Function writing nFrames source frames starting at startFrame to
+   * left and right. Frames outside of the source are expected to be zero.
+   */
+  using Source = std::function<void(const qint64 startFrame,
+                                    const size_t nFrames, float* left,
+                                    float* right)>;
+
+  TimeStretcher(void);
+
+  /**
+   * \brief Discard the stretch state and continue at a source position
+   *
+   * \param[in] source - source to read the frames around position from
+   * \param[in] position - source frame of the next output frame
+   * \param[in] speed - source frames per output frame
+   */
+  void reset(const Source& source, const qint64 position, const double speed);
+
+  /**
+   * \brief Get the source position of the next output frame
+   */
+  double getPosition(void) const { return mPosition; }
+
+  /**
+   * \brief Produce stretched output frames and advance the position by speed
+   * per frame
+   *
+   * \param[in] source - source to read frames from
+   * \param[in] nFrames - number of output frames
+   * \param[out] left - left channel output of at least nFrames
+   * \param[out] right - right channel output of at least nFrames
+   */
+  void process(const Source& source, const size_t nFrames, float* left,
+               float* right);
+
+ private:
+  static const int frameLength{1024};  /**< analysis window, ~23 ms */
+  static const int hopLength{512};     /**< output hop, half a window */
+  static const int tolerance{256};     /**< max shift of a frame */
+
+  double mSpeed{1.0};
+  double mPosition{0.0};      /**< source position of next output frame */
+  double mAnalysisPos{0.0};   /**< nominal start of next analysis frame */
+  qint64 mPreviousStart{0};   /**< actual start of previous frame */
+
+  std::vector<float> mWindow;
+  // second half of previous windowed frame, to overlap with next frame
+  std::vector<float> mTailLeft;
+  std::vector<float> mTailRight;
+  // output frames ready to be read
+  std::vector<float> mReadyLeft;
+  std::vector<float> mReadyRight;
+  size_t mReadyIndex{0};
+  // source frames for the search and the continuation of the previous frame
+  std::vector<float> mSearchLeft;
+  std::vector<float> mSearchRight;
+  std::vector<float> mContinuationLeft;
+  std::vector<float> mContinuationRight;
+
+  /**
+   * \brief Search, window and overlap-add the next frame, producing hopLength
+   * ready output frames
+   */
+  void addFrame(const Source& source);
+};
+
+#endif  // SRC_TIME_STRETCHER_H_
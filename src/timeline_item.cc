@@ -0,0 +1,270 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/timeline_item.h"
+
+#include <QHash>
+#include <QQuickWindow>
+#include <QSGSimpleRectNode>
+#include <QSGSimpleTextureNode>
+#include <QSGTexture>
+#include <QSet>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+// Root node owning the tile textures, which live in the render thread
+class TileRootNode : public QSGNode {
+ public:
+  TileRootNode(void) : background{new QSGSimpleRectNode()} {
+    appendChildNode(background);
+  }
+  ~TileRootNode() override { qDeleteAll(textures); }
+
+  QSGSimpleRectNode* background;
+  QHash<quint64, QSGTexture*> textures;  /**< by level id and tile index */
+};
+
+quint64 getTextureKey(const int levelId, const int index) {
+  return (static_cast<quint64>(static_cast<quint32>(levelId)) << 32) |
+         static_cast<quint32>(index);
+}
+}  // namespace
+
+TimelineItem::TimelineItem(QQuickItem* parent) : QQuickItem{parent} {
+  setFlag(ItemHasContents, true);
+  updateRenderer();
+}
+
+void TimelineItem::setBeats(BeatModel* beats) {
+  if (beats == mBeats) {
+    return;
+  }
+  mBeats = beats;
+  updateRenderer();
+  emit beatsChanged();
+}
+
+void TimelineItem::setPeaks(WaveformPeaks* peaks) {
+  if (peaks == mPeaks) {
+    return;
+  }
+  mPeaks = peaks;
+  updateRenderer();
+  emit peaksChanged();
+}
+
+void TimelineItem::setStartFrame(const qreal startFrame) {
+  if (startFrame == mStartFrame) {
+    return;
+  }
+  mStartFrame = startFrame;
+  emit startFrameChanged();
+  update();
+}
+
+void TimelineItem::setFrameToPixels(const qreal frameToPixels) {
+  if (frameToPixels == mFrameToPixels || frameToPixels <= 0.0) {
+    return;
+  }
+  mFrameToPixels = frameToPixels;
+  mRenderer->setFrameToPixels(mFrameToPixels);
+  emit frameToPixelsChanged();
+  update();
+}
+
+void TimelineItem::setColor(const QColor& color) {
+  if (color == mColor) {
+    return;
+  }
+  mColor = color;
+  emit colorChanged();
+  update();
+}
+
+void TimelineItem::setBarColor(const QColor& color) {
+  if (color == mStyle.barColor) {
+    return;
+  }
+  mStyle.barColor = color;
+  updateRenderer();
+  emit barColorChanged();
+}
+
+void TimelineItem::setBeatColor(const QColor& color) {
+  if (color == mStyle.beatColor) {
+    return;
+  }
+  mStyle.beatColor = color;
+  updateRenderer();
+  emit beatColorChanged();
+}
+
+void TimelineItem::setBeatWidth(const qreal width) {
+  if (width == mStyle.beatWidth) {
+    return;
+  }
+  mStyle.beatWidth = width;
+  updateRenderer();
+  emit beatWidthChanged();
+}
+
+void TimelineItem::setWaveformColor(const QColor& color) {
+  if (color == mStyle.waveformColor) {
+    return;
+  }
+  mStyle.waveformColor = color;
+  updateRenderer();
+  emit waveformColorChanged();
+}
+
+void TimelineItem::setWaveformRmsColor(const QColor& color) {
+  if (color == mStyle.waveformRmsColor) {
+    return;
+  }
+  mStyle.waveformRmsColor = color;
+  updateRenderer();
+  emit waveformRmsColorChanged();
+}
+
+void TimelineItem::geometryChanged(const QRectF& newGeometry,
+                                   const QRectF& oldGeometry) {
+  QQuickItem::geometryChanged(newGeometry, oldGeometry);
+  // tiles are as high as the item:
+  const int height = static_cast<int>(std::ceil(newGeometry.height()));
+  if (height != mStyle.height) {
+    mStyle.height = height;
+    updateRenderer();
+  }
+}
+
+void TimelineItem::updateRenderer(void) {
+  std::shared_ptr<TimelineTileRenderer> renderer =
+      TimelineTileRenderer::getShared(mBeats, mPeaks, mStyle);
+  if (renderer != mRenderer) {
+    if (mRenderer) {
+      disconnect(mRenderer.get(), nullptr, this, nullptr);
+    }
+    mRenderer = std::move(renderer);
+    connect(mRenderer.get(), &TimelineTileRenderer::tilesChanged, this,
+            &QQuickItem::update);
+  }
+  mRenderer->setFrameToPixels(mFrameToPixels);
+  update();
+}
+
+QSGNode* TimelineItem::updatePaintNode(
+    QSGNode* oldNode, UpdatePaintNodeData* updatePaintNodeData) {
+  Q_UNUSED(updatePaintNodeData);
+  TileRootNode* root = static_cast<TileRootNode*>(oldNode);
+  if (!root) {
+    root = new TileRootNode();
+  }
+  // background below the tiles, which is all that differs between items
+  // sharing a renderer:
+  root->background->setRect(boundingRect());
+  root->background->setColor(mColor);
+
+  // tile nodes are cheap, rebuild them every time:
+  while (root->childCount() > 1) {
+    QSGNode* node = root->lastChild();
+    root->removeChildNode(node);
+    delete node;
+  }
+
+  QSet<quint64> usedTextures;
+  const auto addTile = [&](const int levelId, const int index,
+                           const QImage& image, const QRectF& rect,
+                           const QRectF& sourceRect) {
+    const quint64 key = getTextureKey(levelId, index);
+    QSGTexture* texture = root->textures.value(key, nullptr);
+    if (!texture) {
+      texture = window()->createTextureFromImage(image);
+      root->textures.insert(key, texture);
+    }
+    usedTextures.insert(key);
+    QSGSimpleTextureNode* node = new QSGSimpleTextureNode();
+    node->setTexture(texture);
+    node->setRect(rect);
+    node->setSourceRect(sourceRect);
+    root->appendChildNode(node);
+  };
+
+  // visible tiles of the current level:
+  const qreal tileWidth = TimelineTileRenderer::tileWidth;
+  const qreal tileHeight = std::max(1, mStyle.height);
+  const qreal viewStart = mStartFrame * mFrameToPixels;
+  const int firstTile = static_cast<int>(std::floor(viewStart / tileWidth));
+  const int lastTile =
+      static_cast<int>(std::floor((viewStart + width()) / tileWidth));
+  const int levelId = mRenderer->getLevelId();
+  const qreal fallbackFrameToPixels = mRenderer->getFallbackFrameToPixels();
+  for (int t = std::max(0, firstTile); t <= lastTile; ++t) {
+    const QRectF rect(t * tileWidth - viewStart, 0.0, tileWidth, height());
+    const QImage* tile = mRenderer->getTile(t);
+    if (tile) {
+      addTile(levelId, t, *tile, rect,
+              QRectF(0.0, 0.0, tileWidth, tileHeight));
+      continue;
+    }
+    if (fallbackFrameToPixels <= 0.0) {
+      continue;
+    }
+    // show the tiles of the previous level covering this tile, scaled and
+    // cropped to it:
+    const qreal scale = mFrameToPixels / fallbackFrameToPixels;
+    const qreal fallbackStart = (viewStart + rect.left()) / scale;
+    const qreal fallbackEnd = (viewStart + rect.right()) / scale;
+    const int firstFallback =
+        static_cast<int>(std::floor(fallbackStart / tileWidth));
+    const int lastFallback =
+        static_cast<int>(std::ceil(fallbackEnd / tileWidth)) - 1;
+    for (int f = std::max(0, firstFallback); f <= lastFallback; ++f) {
+      const QImage* fallback = mRenderer->getFallbackTile(f);
+      if (!fallback) {
+        continue;
+      }
+      const QRectF fallbackRect(f * tileWidth * scale - viewStart, 0.0,
+                                tileWidth * scale, height());
+      const QRectF target = rect.intersected(fallbackRect);
+      if (target.isEmpty()) {
+        continue;
+      }
+      const QRectF source((target.left() - fallbackRect.left()) / scale, 0.0,
+                          target.width() / scale, tileHeight);
+      addTile(mRenderer->getFallbackLevelId(), f, *fallback, target, source);
+    }
+  }
+
+  // release textures of tiles that are neither shown nor cached anymore:
+  for (auto it = root->textures.begin(); it != root->textures.end();) {
+    const int keyLevelId = static_cast<int>(it.key() >> 32);
+    const int keyIndex = static_cast<int>(it.key() & 0xFFFFFFFFu);
+    if (!usedTextures.contains(it.key()) &&
+        !mRenderer->contains(keyLevelId, keyIndex)) {
+      delete it.value();
+      it = root->textures.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return root;
+}
@@ -0,0 +1,135 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_TIMELINE_ITEM_H_
+#define SRC_TIMELINE_ITEM_H_
+
+#include <QColor>
+#include <QPointer>
+#include <QQuickItem>
+
+#include <memory>
+
+#include "src/beat_model.h"
+#include "src/timeline_tile_renderer.h"
+#include "src/waveform_peaks.h"
+
+/** \class TimelineItem
+ * \brief Scene graph QML item drawing the background of a frame range of the
+ * timeline, i.e. bar shading, beat lines and waveform.
+ *
+ * The item is meant to cover the visible part of the timeline only. It shows
+ * tiles rendered by a TimelineTileRenderer on worker threads as textures,
+ * such that scrolling only places cached tiles and the GUI thread never
+ * rasterizes. After zooming, tiles of the previous zoom level are shown
+ * scaled until the new ones are ready. The tiles are transparent and shown
+ * on top of the item color, such that items differing in color only share
+ * their tiles.
+ */
+class TimelineItem : public QQuickItem {
+  Q_OBJECT;
+  Q_PROPERTY(BeatModel* beats READ beats WRITE setBeats NOTIFY beatsChanged);
+  Q_PROPERTY(WaveformPeaks* peaks READ peaks WRITE setPeaks NOTIFY
+                 peaksChanged);
+  Q_PROPERTY(qreal startFrame READ startFrame WRITE setStartFrame NOTIFY
+                 startFrameChanged);
+  Q_PROPERTY(qreal frameToPixels READ frameToPixels WRITE setFrameToPixels
+                 NOTIFY frameToPixelsChanged);
+  Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged);
+  Q_PROPERTY(
+      QColor barColor READ barColor WRITE setBarColor NOTIFY barColorChanged);
+  Q_PROPERTY(QColor beatColor READ beatColor WRITE setBeatColor NOTIFY
+                 beatColorChanged);
+  Q_PROPERTY(qreal beatWidth READ beatWidth WRITE setBeatWidth NOTIFY
+                 beatWidthChanged);
+  Q_PROPERTY(QColor waveformColor READ waveformColor WRITE setWaveformColor
+                 NOTIFY waveformColorChanged);
+  Q_PROPERTY(QColor waveformRmsColor READ waveformRmsColor WRITE
+                 setWaveformRmsColor NOTIFY waveformRmsColorChanged);
+
+ public:
+  explicit TimelineItem(QQuickItem* parent = nullptr);
+
+  BeatModel* beats(void) const { return mBeats; }
+  WaveformPeaks* peaks(void) const { return mPeaks; }
+  qreal startFrame(void) const { return mStartFrame; }
+  qreal frameToPixels(void) const { return mFrameToPixels; }
+  QColor color(void) const { return mColor; }
+  QColor barColor(void) const { return mStyle.barColor; }
+  QColor beatColor(void) const { return mStyle.beatColor; }
+  qreal beatWidth(void) const { return mStyle.beatWidth; }
+  QColor waveformColor(void) const { return mStyle.waveformColor; }
+  QColor waveformRmsColor(void) const { return mStyle.waveformRmsColor; }
+
+  /**
+   * \brief Set the beats to draw. The item redraws whenever the beats change.
+   */
+  void setBeats(BeatModel* beats);
+
+  /**
+   * \brief Set the waveform to draw. The item redraws whenever the waveform
+   * changes.
+   */
+  void setPeaks(WaveformPeaks* peaks);
+
+  void setStartFrame(const qreal startFrame);
+  void setFrameToPixels(const qreal frameToPixels);
+  void setColor(const QColor& color);
+  void setBarColor(const QColor& color);
+  void setBeatColor(const QColor& color);
+  void setBeatWidth(const qreal width);
+  void setWaveformColor(const QColor& color);
+  void setWaveformRmsColor(const QColor& color);
+
+  // NOLINTNEXTLINE
+ signals:
+  void beatsChanged(void);
+  void peaksChanged(void);
+  void startFrameChanged(void);
+  void frameToPixelsChanged(void);
+  void colorChanged(void);
+  void barColorChanged(void);
+  void beatColorChanged(void);
+  void beatWidthChanged(void);
+  void waveformColorChanged(void);
+  void waveformRmsColorChanged(void);
+
+ protected:
+  QSGNode* updatePaintNode(QSGNode* oldNode,
+                           UpdatePaintNodeData* updatePaintNodeData) override;
+  void geometryChanged(const QRectF& newGeometry,
+                       const QRectF& oldGeometry) override;
+
+ private:
+  QPointer<BeatModel> mBeats;
+  QPointer<WaveformPeaks> mPeaks;
+  qreal mStartFrame{0.0};
+  qreal mFrameToPixels{1.0};
+  QColor mColor{Qt::white};
+  TimelineTileRenderer::Style mStyle;
+  std::shared_ptr<TimelineTileRenderer> mRenderer;
+
+  /**
+   * \brief Switch to the renderer of the current beats, waveform and style,
+   * and redraw
+   */
+  void updateRenderer(void);
+};
+
+#endif  // SRC_TIMELINE_ITEM_H_
@@ -0,0 +1,101 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/timeline_layout.h"
+
+#include <QVector>
+
+TimelineLayout::TimelineLayout(QQuickItem* parent) : QQuickItem{parent} {}
+
+void TimelineLayout::setFrameToPixels(const qreal frameToPixels) {
+  if (frameToPixels == mFrameToPixels || frameToPixels <= 0.0) {
+    return;
+  }
+  mFrameToPixels = frameToPixels;
+  emit frameToPixelsChanged();
+  polish();
+}
+
+void TimelineLayout::setViewStartFrame(const qreal frame) {
+  if (frame == mViewStartFrame) {
+    return;
+  }
+  mViewStartFrame = frame;
+  emit viewStartFrameChanged();
+  polish();
+}
+
+void TimelineLayout::setViewEndFrame(const qreal frame) {
+  if (frame == mViewEndFrame) {
+    return;
+  }
+  mViewEndFrame = frame;
+  emit viewEndFrameChanged();
+  polish();
+}
+
+void TimelineLayout::place(QQuickItem* item, const qreal startFrame,
+                           const qreal endFrame, const qreal margin) {
+  if (!item) {
+    return;
+  }
+  if (!mPlacements.contains(item)) {
+    connect(item, &QObject::destroyed, this, [this](QObject* object) {
+      mPlacements.remove(static_cast<QQuickItem*>(object));
+    });
+  }
+  Placement& placement = mPlacements[item];
+  placement.startFrame = startFrame;
+  placement.endFrame = endFrame;
+  placement.margin = margin;
+  layOut(item, &placement);
+}
+
+void TimelineLayout::release(QQuickItem* item) {
+  if (mPlacements.remove(item)) {
+    disconnect(item, &QObject::destroyed, this, nullptr);
+  }
+}
+
+void TimelineLayout::updatePolish(void) {
+  // collect first, as positioning may run handlers placing items again:
+  QVector<QQuickItem*> stale;
+  for (auto it = mPlacements.cbegin(); it != mPlacements.cend(); ++it) {
+    const Placement& placement = it.value();
+    if (placement.frameToPixels != mFrameToPixels &&
+        placement.endFrame >= mViewStartFrame &&
+        placement.startFrame <= mViewEndFrame) {
+      stale.append(it.key());
+    }
+  }
+  for (QQuickItem* item : stale) {
+    auto it = mPlacements.find(item);
+    if (it != mPlacements.end()) {
+      layOut(item, &it.value());
+    }
+  }
+}
+
+void TimelineLayout::layOut(QQuickItem* item, Placement* placement) const {
+  item->setX(placement->startFrame * mFrameToPixels - placement->margin);
+  item->setWidth((placement->endFrame - placement->startFrame) *
+                     mFrameToPixels +
+                 2.0 * placement->margin);
+  placement->frameToPixels = mFrameToPixels;
+}
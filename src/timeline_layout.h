@@ -0,0 +1,104 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_TIMELINE_LAYOUT_H_
+#define SRC_TIMELINE_LAYOUT_H_
+
+#include <QHash>
+#include <QQuickItem>
+
+/** \class TimelineLayout
+ * \brief Non-visual QML item positioning timeline items given in frames.
+ *
+ * Items are placed by their frame range and converted to pixels with a
+ * single frameToPixels factor, such that a zoom step is one property change
+ * instead of re-evaluating the bindings of every item. After a zoom step,
+ * only the items intersecting the view window are laid out again, once per
+ * rendered frame. The others are laid out when the window reaches them.
+ *
+ * Items are positioned in the coordinates of their parent, which has to
+ * share the horizontal origin of the timeline.
+ */
+class TimelineLayout : public QQuickItem {
+  Q_OBJECT;
+  Q_PROPERTY(qreal frameToPixels READ frameToPixels WRITE setFrameToPixels
+                 NOTIFY frameToPixelsChanged);
+  Q_PROPERTY(qreal viewStartFrame READ viewStartFrame WRITE setViewStartFrame
+                 NOTIFY viewStartFrameChanged);
+  Q_PROPERTY(qreal viewEndFrame READ viewEndFrame WRITE setViewEndFrame NOTIFY
+                 viewEndFrameChanged);
+
+ public:
+  explicit TimelineLayout(QQuickItem* parent = nullptr);
+
+  qreal frameToPixels(void) const { return mFrameToPixels; }
+  qreal viewStartFrame(void) const { return mViewStartFrame; }
+  qreal viewEndFrame(void) const { return mViewEndFrame; }
+
+  void setFrameToPixels(const qreal frameToPixels);
+  void setViewStartFrame(const qreal frame);
+  void setViewEndFrame(const qreal frame);
+
+  /**
+   * \brief Place an item at a frame range and keep it there when zooming.
+   * The item is positioned immediately.
+   *
+   * \param[in] item - the item to place
+   * \param[in] startFrame - frame of the left edge
+   * \param[in] endFrame - frame of the right edge
+   * \param[in] margin - pixels the item extends beyond either edge
+   */
+  Q_INVOKABLE void place(QQuickItem* item, const qreal startFrame,
+                         const qreal endFrame, const qreal margin);
+
+  /**
+   * \brief Stop positioning an item
+   */
+  Q_INVOKABLE void release(QQuickItem* item);
+
+  // NOLINTNEXTLINE
+ signals:
+  void frameToPixelsChanged(void);
+  void viewStartFrameChanged(void);
+  void viewEndFrameChanged(void);
+
+ protected:
+  void updatePolish(void) override;
+
+ private:
+  // frame range of a placed item
+  struct Placement {
+    qreal startFrame;
+    qreal endFrame;
+    qreal margin;
+    qreal frameToPixels; /**< factor the item was last laid out with */
+  };
+
+  qreal mFrameToPixels{1.0};
+  qreal mViewStartFrame{0.0};
+  qreal mViewEndFrame{0.0};
+  QHash<QQuickItem*, Placement> mPlacements;
+
+  /**
+   * \brief Position an item with the current frameToPixels
+   */
+  void layOut(QQuickItem* item, Placement* placement) const;
+};
+
+#endif  // SRC_TIMELINE_LAYOUT_H_
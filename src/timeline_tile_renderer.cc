@@ -0,0 +1,274 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/timeline_tile_renderer.h"
+
+#include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace {
+// level ids are unique across renderers, such that items switching renderers
+// can keep textures by level id
+int nextLevelId{1};
+
+// renderers handed out by getShared
+std::vector<std::weak_ptr<TimelineTileRenderer>> sharedRenderers;
+
+// pool of all renderers, leaving a core for the GUI and audio threads
+QThreadPool* getPool(void) {
+  static QThreadPool pool;
+  static const bool initialized = []() {
+    pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+    return true;
+  }();
+  Q_UNUSED(initialized);
+  return &pool;
+}
+}  // namespace
+
+std::shared_ptr<TimelineTileRenderer> TimelineTileRenderer::getShared(
+    BeatModel* beats, WaveformPeaks* peaks, const Style& style) {
+  sharedRenderers.erase(
+      std::remove_if(sharedRenderers.begin(), sharedRenderers.end(),
+                     [](const std::weak_ptr<TimelineTileRenderer>& renderer) {
+                       return renderer.expired();
+                     }),
+      sharedRenderers.end());
+  for (const auto& weakRenderer : sharedRenderers) {
+    std::shared_ptr<TimelineTileRenderer> renderer = weakRenderer.lock();
+    if (renderer && renderer->mBeatModel == beats &&
+        renderer->mPeaks == peaks && renderer->mStyle == style) {
+      return renderer;
+    }
+  }
+  auto renderer = std::make_shared<TimelineTileRenderer>(beats, peaks, style);
+  sharedRenderers.push_back(renderer);
+  return renderer;
+}
+
+TimelineTileRenderer::TimelineTileRenderer(BeatModel* beats,
+                                           WaveformPeaks* peaks,
+                                           const Style& style)
+    : mBeatModel{beats},
+      mPeaks{peaks},
+      mStyle{style},
+      mBeats{std::make_shared<const std::vector<int>>()} {
+  if (mBeatModel) {
+    mBeats = std::make_shared<const std::vector<int>>(mBeatModel->getFrames());
+    connect(mBeatModel, &BeatModel::framesChanged, this, [this]() {
+      mBeats =
+          std::make_shared<const std::vector<int>>(mBeatModel->getFrames());
+      invalidate();
+    });
+  }
+  if (mPeaks) {
+    connect(mPeaks, &WaveformPeaks::peaksChanged, this,
+            &TimelineTileRenderer::invalidate);
+  }
+  startLevel(0.0, false);
+}
+
+TimelineTileRenderer::~TimelineTileRenderer() {
+  // make queued jobs return immediately and wait for running ones, as the
+  // pool is shared
+  mCurrentLevelId = -1;
+  for (QFuture<void>& job : mJobs) {
+    job.waitForFinished();
+  }
+}
+
+void TimelineTileRenderer::invalidate(void) {
+  // the content changed, such that no tile can be used as fallback either
+  startLevel(mCurrent.frameToPixels, false);
+  emit tilesChanged();
+}
+
+void TimelineTileRenderer::setFrameToPixels(const qreal frameToPixels) {
+  if (frameToPixels == mCurrent.frameToPixels) {
+    return;
+  }
+  startLevel(frameToPixels, true);
+}
+
+const QImage* TimelineTileRenderer::getTile(const int index) {
+  if (index < 0 || mCurrent.frameToPixels <= 0.0) {
+    return nullptr;
+  }
+  const auto tile = mCurrent.tiles.constFind(index);
+  if (tile != mCurrent.tiles.constEnd()) {
+    // mark most recently used
+    mCurrent.lru.remove(index);
+    mCurrent.lru.push_front(index);
+    return &tile.value();
+  }
+
+  if (!mPending.contains(index)) {
+    mPending.insert(index);
+    mJobs.erase(std::remove_if(mJobs.begin(), mJobs.end(),
+                               [](const QFuture<void>& job) {
+                                 return job.isFinished();
+                               }),
+                mJobs.end());
+    const Job job{mCurrent.id, index,  mCurrent.frameToPixels,
+                  mStyle,      mBeats, mPeaks.data()};
+    mJobs.push_back(QtConcurrent::run(getPool(), [this, job]() {
+      // skip jobs of levels left while they were queued
+      if (job.levelId != mCurrentLevelId) {
+        return;
+      }
+      const QImage image = render(job);
+      QMetaObject::invokeMethod(
+          this,
+          [this, job, image]() {
+            handleTileRendered(job.levelId, job.index, image);
+          },
+          Qt::QueuedConnection);
+    }));
+  }
+  return nullptr;
+}
+
+const QImage* TimelineTileRenderer::getFallbackTile(const int index) const {
+  const auto tile = mPrevious.tiles.constFind(index);
+  return tile != mPrevious.tiles.constEnd() ? &tile.value() : nullptr;
+}
+
+bool TimelineTileRenderer::contains(const int levelId, const int index) const {
+  if (levelId == mCurrent.id) {
+    return mCurrent.tiles.contains(index);
+  }
+  return levelId == mPrevious.id && mPrevious.tiles.contains(index);
+}
+
+void TimelineTileRenderer::startLevel(const qreal frameToPixels,
+                                      const bool keepFallback) {
+  // keep the current level as fallback only if it has anything to show, such
+  // that fast zooming keeps the last complete level
+  if (!keepFallback) {
+    mPrevious = Level{};
+  } else if (!mCurrent.tiles.isEmpty()) {
+    mPrevious = std::move(mCurrent);
+  }
+  mCurrent = Level{};
+  mCurrent.id = nextLevelId++;
+  mCurrent.frameToPixels = frameToPixels;
+  mCurrentLevelId = mCurrent.id;
+  mPending.clear();
+}
+
+void TimelineTileRenderer::handleTileRendered(const int levelId,
+                                              const int index,
+                                              const QImage& image) {
+  if (levelId != mCurrent.id) {
+    return;
+  }
+  mPending.remove(index);
+  mCurrent.tiles.insert(index, image);
+  mCurrent.lru.push_front(index);
+  while (mCurrent.lru.size() > static_cast<size_t>(maxTilesPerLevel)) {
+    mCurrent.tiles.remove(mCurrent.lru.back());
+    mCurrent.lru.pop_back();
+  }
+  emit tilesChanged();
+}
+
+QImage TimelineTileRenderer::render(const Job& job) {
+  const Style& style = job.style;
+  QImage image(tileWidth, std::max(1, style.height),
+               QImage::Format_ARGB32_Premultiplied);
+  image.fill(Qt::transparent);
+  QPainter painter(&image);
+
+  const qreal startFrame = job.index * tileWidth / job.frameToPixels;
+  const qreal endFrame = (job.index + 1) * tileWidth / job.frameToPixels;
+  const qreal height = image.height();
+  const std::vector<int>& beats = *job.beats;
+  const auto toPixel = [&](const qreal frame) {
+    return (frame - startFrame) * job.frameToPixels;
+  };
+
+  // shade every other bar, starting with the bar containing the tile start:
+  if (beats.size() > 1 && style.beatsPerBar > 0) {
+    const size_t firstBeat = static_cast<size_t>(std::max<std::ptrdiff_t>(
+        0, std::upper_bound(beats.begin(), beats.end(), startFrame) -
+               beats.begin() - 1));
+    const size_t beatsPerBar = static_cast<size_t>(style.beatsPerBar);
+    for (size_t bar = firstBeat / beatsPerBar;
+         bar * beatsPerBar < beats.size() - 1; ++bar) {
+      const int barStart = beats[bar * beatsPerBar];
+      if (barStart >= endFrame) {
+        break;
+      }
+      if (bar % 2 == 1) {
+        const int barEnd =
+            beats[std::min((bar + 1) * beatsPerBar, beats.size() - 1)];
+        painter.fillRect(QRectF(toPixel(barStart), 0.0,
+                                (barEnd - barStart) * job.frameToPixels,
+                                height),
+                         style.barColor);
+      }
+    }
+  }
+
+  // beat lines, including the ones overlapping the tile edges:
+  const qreal halfWidth = style.beatWidth / 2.0;
+  const qreal margin = halfWidth / job.frameToPixels;
+  painter.setRenderHint(QPainter::Antialiasing);
+  for (auto beat =
+           std::lower_bound(beats.begin(), beats.end(), startFrame - margin);
+       beat != beats.end() && *beat <= endFrame + margin; ++beat) {
+    painter.fillRect(
+        QRectF(toPixel(*beat) - halfWidth, 0.0, style.beatWidth, height),
+        style.beatColor);
+  }
+  painter.setRenderHint(QPainter::Antialiasing, false);
+
+  // waveform on top, min/max of each pixel column and RMS centered
+  // vertically:
+  if (job.peaks) {
+    std::vector<WaveformPeaks::Peak> columns(tileWidth);
+    job.peaks->getColumns(startFrame, 1.0 / job.frameToPixels, columns.size(),
+                          columns.data());
+    const qreal center = height / 2.0;
+    QVector<QLineF> peakLines;
+    QVector<QLineF> rmsLines;
+    peakLines.reserve(tileWidth);
+    rmsLines.reserve(tileWidth);
+    for (int c = 0; c < tileWidth; ++c) {
+      const WaveformPeaks::Peak& peak = columns[static_cast<size_t>(c)];
+      const qreal x = c + 0.5;
+      peakLines.append(QLineF(x, center - peak.max * center, x,
+                              center - peak.min * center));
+      rmsLines.append(QLineF(x, center - peak.rms * center, x,
+                             center + peak.rms * center));
+    }
+    painter.setPen(QPen(style.waveformColor, 1.0));
+    painter.drawLines(peakLines);
+    painter.setPen(QPen(style.waveformRmsColor, 1.0));
+    painter.drawLines(rmsLines);
+  }
+  return image;
+}
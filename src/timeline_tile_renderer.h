@@ -0,0 +1,210 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_TIMELINE_TILE_RENDERER_H_
+#define SRC_TIMELINE_TILE_RENDERER_H_
+
+#include <QColor>
+#include <QFuture>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "src/beat_model.h"
+#include "src/waveform_peaks.h"
+
+/** \class TimelineTileRenderer
+ * \brief Renders fixed-width tiles of the timeline background, i.e. bar
+ * shading, beat lines and waveform, into transparent images on worker threads
+ * and caches them per zoom level.
+ *
+ * Tile t of a zoom level covers the pixels [t * tileWidth, (t + 1) *
+ * tileWidth) at that level's frameToPixels. The tiles of the current level
+ * and of the level before are cached, each with a least recently used budget
+ * of maxTilesPerLevel, such that the previous level can be shown scaled until
+ * the tiles of the current level are ready. Requests for a level are dropped
+ * once the level changes. All functions are to be called from the main
+ * thread, or while it is blocked, e.g. from updatePaintNode.
+ *
+ * Items showing the same beats, waveform and style get the same renderer from
+ * getShared, such that identical tiles are rendered once, and all renderers
+ * share one thread pool. Items sharing a renderer also share its zoom level.
+ */
+class TimelineTileRenderer : public QObject {
+  Q_OBJECT;
+
+ public:
+  static const int tileWidth{256};        /**< tile width in pixels */
+  static const int maxTilesPerLevel{64};  /**< LRU budget of a level */
+
+  /**
+   * \brief Colors and sizes to draw tiles with. The background is left to
+   * the items.
+   */
+  struct Style {
+    QColor barColor{Qt::lightGray};  /**< shading of every other bar */
+    QColor beatColor{Qt::black};
+    QColor waveformColor{Qt::black};
+    QColor waveformRmsColor{Qt::darkGray};
+    qreal beatWidth{1.0};
+    int beatsPerBar{4};
+    int height{1};
+
+    bool operator==(const Style& other) const {
+      return barColor == other.barColor && beatColor == other.beatColor &&
+             waveformColor == other.waveformColor &&
+             waveformRmsColor == other.waveformRmsColor &&
+             beatWidth == other.beatWidth &&
+             beatsPerBar == other.beatsPerBar && height == other.height;
+    }
+  };
+
+  /**
+   * \brief Get the renderer of beats, waveform and style, creating it if no
+   * item uses it yet
+   *
+   * \param[in] beats - beats to draw, or nullptr
+   * \param[in] peaks - waveform to draw, or nullptr, which has to stay valid
+   * while the renderer exists
+   * \param[in] style - colors and sizes to draw with
+   */
+  static std::shared_ptr<TimelineTileRenderer> getShared(
+      BeatModel* beats, WaveformPeaks* peaks, const Style& style);
+
+  /**
+   * \brief Create a renderer, which discards its tiles whenever the beats
+   * or the waveform change. Use getShared instead to share tiles.
+   */
+  TimelineTileRenderer(BeatModel* beats, WaveformPeaks* peaks,
+                       const Style& style);
+  ~TimelineTileRenderer();
+
+  /**
+   * \brief Set the zoom level, keeping the tiles of the current level as
+   * fallback unless it has none
+   */
+  void setFrameToPixels(const qreal frameToPixels);
+
+  /**
+   * \brief Get an id of the current level, which changes whenever the level
+   * or the tile content changes
+   */
+  int getLevelId(void) const { return mCurrent.id; }
+
+  /**
+   * \brief Get a tile of the current level, requesting it from a worker
+   * thread if it is not cached
+   *
+   * \return the tile, or nullptr if it is not ready yet
+   */
+  const QImage* getTile(const int index);
+
+  /**
+   * \brief Get a cached tile of the previous level without requesting it
+   *
+   * \return the tile, or nullptr if it is not cached
+   */
+  const QImage* getFallbackTile(const int index) const;
+
+  /**
+   * \brief Get frameToPixels of the previous level
+   */
+  qreal getFallbackFrameToPixels(void) const {
+    return mPrevious.frameToPixels;
+  }
+
+  /**
+   * \brief Get an id of the previous level, see getLevelId
+   */
+  int getFallbackLevelId(void) const { return mPrevious.id; }
+
+  /**
+   * \brief Check if a tile of a level is still cached
+   */
+  bool contains(const int levelId, const int index) const;
+
+  // NOLINTNEXTLINE
+ signals:
+  /**
+   * \brief Emitted when a requested tile of the current level is ready, or
+   * when all tiles were discarded
+   */
+  void tilesChanged(void);
+
+ private:
+  // cached tiles of a zoom level
+  struct Level {
+    int id{0};
+    qreal frameToPixels{0.0};
+    QHash<int, QImage> tiles;
+    std::list<int> lru;  /**< tile indices, most recently used first */
+  };
+
+  // everything a worker needs to render a tile
+  struct Job {
+    int levelId;
+    int index;
+    qreal frameToPixels;
+    Style style;
+    std::shared_ptr<const std::vector<int>> beats;
+    const WaveformPeaks* peaks;
+  };
+
+  QPointer<BeatModel> mBeatModel;
+  QPointer<WaveformPeaks> mPeaks;
+  const Style mStyle;
+  std::shared_ptr<const std::vector<int>> mBeats;
+
+  std::atomic<int> mCurrentLevelId{0};
+  Level mCurrent;
+  Level mPrevious;
+  QSet<int> mPending;
+  std::vector<QFuture<void>> mJobs;
+
+  /**
+   * \brief Discard all tiles, e.g. after the waveform changed
+   */
+  void invalidate(void);
+
+  /**
+   * \brief Start a new, empty current level, keeping the current one as
+   * fallback or discarding all tiles
+   */
+  void startLevel(const qreal frameToPixels, const bool keepFallback);
+
+  /**
+   * \brief Store a rendered tile if its level is still current
+   */
+  void handleTileRendered(const int levelId, const int index,
+                          const QImage& image);
+
+  /**
+   * \brief Draw a tile, called from a worker thread
+   */
+  static QImage render(const Job& job);
+};
+
+#endif  // SRC_TIMELINE_TILE_RENDERER_H_
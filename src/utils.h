@@ -20,6 +20,7 @@
 #ifndef SRC_UTILS_H_
 #define SRC_UTILS_H_
 
+#include <algorithm>
 #include <vector>
 
 namespace utils {
@@ -90,6 +91,113 @@ int findInterval(const T value, const std::vector<T>& intervals, size_t* ind,
   }
   return 0;
 }
+
+/** \class IntervalIndex
+ * \brief Lookup table accelerating findInterval on a fixed vector of
+ * monotonically increasing intervals, e.g. the beat frames of a song.
+ *
+ * The value range is split into uniform buckets of the average interval
+ * length, each storing the interval containing its start. A lookup jumps to
+ * the value's bucket and advances over the few intervals starting within it,
+ * which takes constant time on average for evenly spaced intervals.
+ */
+template <class T>
+class IntervalIndex {
+ public:
+  /**
+   * \brief (Re-)build the index for a vector of monotonically increasing
+   * intervals. The intervals are copied.
+   */
+  void build(const std::vector<T>& intervals) {
+    mIntervals = intervals;
+    mBuckets.clear();
+    if (mIntervals.size() < 2) {
+      return;
+    }
+    const T span = mIntervals.back() - mIntervals.front();
+    mBucketSize = span / static_cast<T>(mIntervals.size() - 1);
+    if (mBucketSize <= static_cast<T>(0)) {
+      mBucketSize = static_cast<T>(1);
+    }
+    const size_t nBuckets = static_cast<size_t>(span / mBucketSize) + 1;
+    mBuckets.resize(nBuckets);
+    size_t ind = 0;
+    for (size_t b = 0; b < nBuckets; ++b) {
+      const T bucketStart =
+          mIntervals.front() + static_cast<T>(b) * mBucketSize;
+      while (ind + 2 < mIntervals.size() &&
+             mIntervals[ind + 1] <= bucketStart) {
+        ++ind;
+      }
+      mBuckets[b] = ind;
+    }
+  }
+
+  /**
+   * \brief Remove all intervals
+   */
+  void clear(void) {
+    mIntervals.clear();
+    mBuckets.clear();
+  }
+
+  /**
+   * \brief Find interval index of a value, with the same result and return
+   * value as the free function findInterval
+   */
+  int findInterval(const T value, size_t* ind) const {
+    if (mIntervals.size() < 2 || value < mIntervals.front() ||
+        value >= mIntervals.back()) {
+      return -1;
+    }
+    const size_t bucket = std::min(
+        static_cast<size_t>((value - mIntervals.front()) / mBucketSize),
+        mBuckets.size() - 1);
+    size_t i = mBuckets[bucket];
+    while (mIntervals[i + 1] <= value) {
+      ++i;
+    }
+    *ind = i;
+    return 0;
+  }
+
+  /**
+   * \brief Find the interval indices of many values at once
+   *
+   * \param[in] values - values to look up
+   * \param[out] indices - interval index per value, or -1 if no valid
+   * interval can be found
+   */
+  void findIntervals(const std::vector<T>& values,
+                     std::vector<int>* indices) const {
+    indices->resize(values.size());
+    findIntervals(values.data(), values.size(), indices->data());
+  }
+
+  /**
+   * \brief Find the interval indices of a range of values, writing them
+   * straight into a caller-provided buffer
+   *
+   * \param[in] values - pointer to the first value to look up
+   * \param[in] nValues - number of values
+   * \param[out] indices - buffer of at least nValues entries receiving the
+   * interval index per value, or -1 if no valid interval can be found
+   */
+  void findIntervals(const T* values, const size_t nValues,
+                     int* indices) const {
+    for (size_t i = 0; i < nValues; ++i) {
+      size_t ind = 0;
+      indices[i] =
+          findInterval(values[i], &ind) < 0 ? -1 : static_cast<int>(ind);
+    }
+  }
+
+ private:
+  std::vector<T> mIntervals;
+  std::vector<size_t> mBuckets;  /**< first interval index per bucket */
+  T mBucketSize{1};
+};
+
 }  // namespace utils
 
 #endif  // SRC_UTILS_H_
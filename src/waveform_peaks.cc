@@ -0,0 +1,186 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include "src/waveform_peaks.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WAVEFORM_PEAKS_USE_SSE2
+#endif
+
+#include <QtConcurrent>
+
+#include <algorithm>
+#include <cmath>
+
+const size_t WaveformPeaks::baseBlockFrames;
+const size_t WaveformPeaks::blocksPerTask;
+
+WaveformPeaks::WaveformPeaks(QObject* parent) : QObject{parent} {}
+
+void WaveformPeaks::build(const std::vector<float>* samples) {
+  // build into local levels, such that queries are not blocked meanwhile
+  std::vector<std::vector<Peak>> levels;
+  const size_t nFrames = samples->size();
+  levels.emplace_back((nFrames + baseBlockFrames - 1) / baseBlockFrames);
+
+  // split each level into tasks of blocksPerTask peaks:
+  auto buildLevel = [&levels](const size_t level, auto reduceBlock) {
+    std::vector<size_t> tasks;
+    for (size_t i = 0; i < levels[level].size(); i += blocksPerTask) {
+      tasks.push_back(i);
+    }
+    QtConcurrent::blockingMap(tasks, [&](const size_t& first) {
+      const size_t last = std::min(first + blocksPerTask, levels[level].size());
+      for (size_t i = first; i < last; ++i) {
+        levels[level][i] = reduceBlock(i);
+      }
+    });
+  };
+
+  // finest level from samples:
+  buildLevel(0, [samples, nFrames](const size_t block) {
+    const size_t start = block * baseBlockFrames;
+    return reduce(samples->data() + start,
+                  std::min(baseBlockFrames, nFrames - start));
+  });
+
+  // coarser levels from pairs of the previous level:
+  while (levels.back().size() > 1) {
+    const size_t previous = levels.size() - 1;
+    levels.emplace_back((levels[previous].size() + 1) / 2);
+    buildLevel(previous + 1, [&levels, previous](const size_t block) {
+      const std::vector<Peak>& fine = levels[previous];
+      return combine(fine.data() + 2 * block,
+                     std::min(size_t{2}, fine.size() - 2 * block));
+    });
+  }
+
+  {
+    QMutexLocker locker(&mMutex);
+    mSamples = samples;
+    mLevels = std::move(levels);
+  }
+  emit peaksChanged();
+}
+
+void WaveformPeaks::clear(void) {
+  {
+    QMutexLocker locker(&mMutex);
+    mSamples = nullptr;
+    mLevels.clear();
+  }
+  emit peaksChanged();
+}
+
+size_t WaveformPeaks::getNumFrames(void) const {
+  QMutexLocker locker(&mMutex);
+  return mSamples ? mSamples->size() : 0;
+}
+
+void WaveformPeaks::getColumns(const double startFrame,
+                               const double framesPerColumn,
+                               const size_t nColumns, Peak* columns) const {
+  QMutexLocker locker(&mMutex);
+  std::fill(columns, columns + nColumns, Peak{});
+  if (!mSamples || mSamples->empty() || framesPerColumn <= 0.0) {
+    return;
+  }
+  const double nFrames = static_cast<double>(mSamples->size());
+
+  // coarsest level with blocks not wider than a column, or the samples:
+  size_t level = 0;
+  size_t blockFrames = 1;
+  if (framesPerColumn >= baseBlockFrames) {
+    level = static_cast<size_t>(
+        std::log2(framesPerColumn / static_cast<double>(baseBlockFrames)));
+    level = std::min(level, mLevels.size() - 1);
+    blockFrames = baseBlockFrames << level;
+  }
+
+  for (size_t c = 0; c < nColumns; ++c) {
+    const double first = std::max(0.0, startFrame + c * framesPerColumn);
+    const double last =
+        std::min(nFrames, startFrame + (c + 1) * framesPerColumn);
+    if (last <= first) {
+      continue;
+    }
+    const size_t firstBlock = static_cast<size_t>(first) / blockFrames;
+    const size_t lastBlock = std::max(
+        firstBlock + 1, static_cast<size_t>(std::ceil(last / blockFrames)));
+    if (framesPerColumn < baseBlockFrames) {
+      columns[c] = reduce(mSamples->data() + firstBlock,
+                          std::min(lastBlock, mSamples->size()) - firstBlock);
+    } else {
+      const std::vector<Peak>& peaks = mLevels[level];
+      columns[c] = combine(peaks.data() + firstBlock,
+                           std::min(lastBlock, peaks.size()) - firstBlock);
+    }
+  }
+}
+
+WaveformPeaks::Peak WaveformPeaks::reduce(const float* samples,
+                                          const size_t nSamples) {
+  size_t i = 0;
+  float minValue = samples[0];
+  float maxValue = samples[0];
+  float sumSquares = 0.0f;
+#ifdef WAVEFORM_PEAKS_USE_SSE2
+  // four samples at a time, reduced horizontally at the end
+  if (nSamples >= 4) {
+    __m128 minVector = _mm_loadu_ps(samples);
+    __m128 maxVector = minVector;
+    __m128 sumVector = _mm_setzero_ps();
+    for (; i + 4 <= nSamples; i += 4) {
+      const __m128 x = _mm_loadu_ps(samples + i);
+      minVector = _mm_min_ps(minVector, x);
+      maxVector = _mm_max_ps(maxVector, x);
+      sumVector = _mm_add_ps(sumVector, _mm_mul_ps(x, x));
+    }
+    float mins[4], maxs[4], sums[4];
+    _mm_storeu_ps(mins, minVector);
+    _mm_storeu_ps(maxs, maxVector);
+    _mm_storeu_ps(sums, sumVector);
+    minValue = std::min({mins[0], mins[1], mins[2], mins[3]});
+    maxValue = std::max({maxs[0], maxs[1], maxs[2], maxs[3]});
+    sumSquares = (sums[0] + sums[1]) + (sums[2] + sums[3]);
+  }
+#endif
+  // remaining samples, or all samples without SSE2:
+  for (; i < nSamples; ++i) {
+    minValue = std::min(minValue, samples[i]);
+    maxValue = std::max(maxValue, samples[i]);
+    sumSquares += samples[i] * samples[i];
+  }
+  return Peak{minValue, maxValue, std::sqrt(sumSquares / nSamples)};
+}
+
+WaveformPeaks::Peak WaveformPeaks::combine(const Peak* peaks,
+                                           const size_t nPeaks) {
+  Peak result = peaks[0];
+  float sumSquares = peaks[0].rms * peaks[0].rms;
+  for (size_t i = 1; i < nPeaks; ++i) {
+    result.min = std::min(result.min, peaks[i].min);
+    result.max = std::max(result.max, peaks[i].max);
+    sumSquares += peaks[i].rms * peaks[i].rms;
+  }
+  result.rms = std::sqrt(sumSquares / nPeaks);
+  return result;
+}
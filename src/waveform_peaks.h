@@ -0,0 +1,108 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#ifndef SRC_WAVEFORM_PEAKS_H_
+#define SRC_WAVEFORM_PEAKS_H_
+
+#include <QMutex>
+#include <QObject>
+#include <vector>
+
+/** \class WaveformPeaks
+ * \brief Multi-resolution min/max/RMS summary of audio samples for drawing
+ * waveforms at any zoom level.
+ *
+ * The pyramid is built once per song. Its finest level summarizes blocks of
+ * baseBlockFrames samples, and every following level halves the resolution.
+ * Queries pick the level matching the requested column width, such that their
+ * cost depends on the number of columns only. Columns narrower than a base
+ * block are read from the samples directly. The public methods may be called
+ * from different threads.
+ */
+class WaveformPeaks : public QObject {
+  Q_OBJECT;
+
+ public:
+  /** Summary of a range of samples */
+  struct Peak {
+    float min{0.0f};
+    float max{0.0f};
+    float rms{0.0f};
+  };
+
+  explicit WaveformPeaks(QObject* parent = nullptr);
+
+  /**
+   * \brief Build the pyramid for samples, in parallel. The samples are not
+   * copied and have to stay valid until clear is called. Emits peaksChanged.
+   *
+   * \param[in] samples - audio samples to summarize
+   */
+  void build(const std::vector<float>* samples);
+
+  /**
+   * \brief Discard the pyramid and the reference to the samples. Emits
+   * peaksChanged.
+   */
+  void clear(void);
+
+  /**
+   * \brief Get the number of summarized frames
+   */
+  size_t getNumFrames(void) const;
+
+  /**
+   * \brief Summarize consecutive columns of equal width. Columns or parts of
+   * columns outside the samples are zero.
+   *
+   * \param[in] startFrame - first frame of the first column
+   * \param[in] framesPerColumn - width of a column in frames
+   * \param[in] nColumns - number of columns
+   * \param[out] columns - summary of each column, of at least nColumns
+   */
+  void getColumns(const double startFrame, const double framesPerColumn,
+                  const size_t nColumns, Peak* columns) const;
+
+  /**
+   * \brief Summarize a range of samples, using SSE2 where available
+   *
+   * \param[in] samples - first sample of the range
+   * \param[in] nSamples - number of samples, larger than zero
+   */
+  static Peak reduce(const float* samples, const size_t nSamples);
+
+  // NOLINTNEXTLINE
+ signals:
+  void peaksChanged(void);
+
+ private:
+  static const size_t baseBlockFrames{64};
+  static const size_t blocksPerTask{4096};
+
+  mutable QMutex mMutex;
+  const std::vector<float>* mSamples{nullptr};
+  std::vector<std::vector<Peak>> mLevels;
+
+  /**
+   * \brief Combine peaks of equal sized ranges
+   */
+  static Peak combine(const Peak* peaks, const size_t nPeaks);
+};
+
+#endif  // SRC_WAVEFORM_PEAKS_H_
@@ -28,11 +28,21 @@ void DummyUI::receiveNotify(int timeMS) {
   static int count = 0;
   qDebug() << "Notify at " << timeMS << " milliseconds";
 
-  // and play with seek by rewinding to 1s after 2s
+  // and play with seek by rewinding to 1s after 2s, playback continues
   if (timeMS > 2000) {
-    qDebug() << "Rewinding to 1000ms";
-    mAudioPlayer->seek(1000);
-    mAudioPlayer->togglePlay();
+    if (count == 1) {
+      // seek while paused, the playback position has to follow right away:
+      qDebug() << "Pausing and rewinding to 1000ms";
+      mAudioPlayer->pause();
+      mAudioPlayer->seek(1000);
+      const qreal pausedTimeMS = mAudioPlayer->getCurrentPlaybackTime();
+      qDebug() << (qAbs(pausedTimeMS - 1000.0) < 1.0 ? "PASSED" : "FAILED")
+               << "position after seek while paused:" << pausedTimeMS;
+      mAudioPlayer->togglePlay();
+    } else {
+      qDebug() << "Rewinding to 1000ms";
+      mAudioPlayer->seek(1000);
+    }
     // quit application after two rewinds:
     if (count++ > 1) {
       mApp->quit();
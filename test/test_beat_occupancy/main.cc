@@ -0,0 +1,189 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "src/beat_occupancy.h"
+
+namespace {
+// Test Fixture Class that fills a track with random non-overlapping ranges
+// and keeps a per-beat occupancy array to check the index against
+class BeatOccupancyTest : public ::testing::Test {
+ protected:
+  BeatOccupancyTest(void) : mOccupied(mNumBeats, false) {
+    std::mt19937 gen(4321);
+    std::uniform_int_distribution<int> gapDis(0, 6);
+    std::uniform_int_distribution<int> lengthDis(1, 8);
+    mOccupancy.setNumBeats(mNumBeats);
+    int beat = gapDis(gen);
+    while (true) {
+      const int length = lengthDis(gen);
+      if (beat + length > mNumBeats - 1) {
+        break;
+      }
+      mOccupancy.occupy(beat, beat + length);
+      mRanges.push_back({beat, beat + length});
+      for (int i = beat; i < beat + length; ++i) {
+        mOccupied[i] = true;
+      }
+      beat += length + gapDis(gen);
+    }
+  }
+
+  // checks [start, end) against the occupancy array
+  bool bruteIsFree(const int start, const int end) const {
+    if (start < 0 || end > mNumBeats - 1 || start >= end) {
+      return false;
+    }
+    for (int i = start; i < end; ++i) {
+      if (mOccupied[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  const int mNumBeats{500};
+  BeatOccupancy mOccupancy;
+  std::vector<bool> mOccupied;
+  std::vector<std::pair<int, int>> mRanges;
+};
+
+TEST_F(BeatOccupancyTest, IsFree) {
+  for (int start = -2; start < mNumBeats + 2; ++start) {
+    for (int length = 0; length < 12; ++length) {
+      ASSERT_EQ(mOccupancy.isFree(start, start + length),
+                bruteIsFree(start, start + length))
+          << "start " << start << " length " << length;
+    }
+  }
+}
+
+TEST_F(BeatOccupancyTest, FreeLength) {
+  for (int start = -2; start < mNumBeats + 2; ++start) {
+    for (int maxLength = 0; maxLength < 12; ++maxLength) {
+      int length = 0;
+      while (length < maxLength && bruteIsFree(start, start + length + 1)) {
+        ++length;
+      }
+      ASSERT_EQ(mOccupancy.getFreeLength(start, maxLength), length)
+          << "start " << start << " max length " << maxLength;
+    }
+  }
+}
+
+TEST_F(BeatOccupancyTest, NearestFreeStart) {
+  for (int beat = -2; beat < mNumBeats + 2; ++beat) {
+    for (int length = 1; length < 12; ++length) {
+      const int nearest = mOccupancy.getNearestFreeStart(beat, length);
+      const int clampedBeat =
+          std::max(0, std::min(beat, mNumBeats - 1 - length));
+      // find nearest free start by brute force:
+      int bestDistance = -1;
+      for (int start = 0; start + length <= mNumBeats - 1; ++start) {
+        const int distance = std::abs(start - clampedBeat);
+        if (bruteIsFree(start, start + length) &&
+            (bestDistance < 0 || distance < bestDistance)) {
+          bestDistance = distance;
+        }
+      }
+      if (bestDistance < 0) {
+        ASSERT_EQ(nearest, -1);
+      } else {
+        ASSERT_TRUE(bruteIsFree(nearest, nearest + length))
+            << "beat " << beat << " length " << length;
+        ASSERT_EQ(std::abs(nearest - clampedBeat), bestDistance)
+            << "beat " << beat << " length " << length;
+      }
+    }
+  }
+}
+
+TEST_F(BeatOccupancyTest, NearestFreeStartAfterChanges) {
+  // free and occupy ranges at random, checking the nearest free start of a
+  // few beats and lengths after every change:
+  std::mt19937 gen(8765);
+  std::uniform_int_distribution<int> beatDis(-2, mNumBeats + 2);
+  std::uniform_int_distribution<int> lengthDis(1, 16);
+  for (int i = 0; i < 300; ++i) {
+    const size_t index = gen() % mRanges.size();
+    const std::pair<int, int> range = mRanges[index];
+    mOccupancy.free(range.first, range.second);
+    for (int b = range.first; b < range.second; ++b) {
+      mOccupied[b] = false;
+    }
+    const int length = lengthDis(gen);
+    const int start = mOccupancy.getNearestFreeStart(beatDis(gen), length);
+    if (start >= 0) {
+      mOccupancy.occupy(start, start + length);
+      for (int b = start; b < start + length; ++b) {
+        mOccupied[b] = true;
+      }
+      mRanges[index] = {start, start + length};
+    } else {
+      mRanges.erase(mRanges.begin() + index);
+    }
+
+    for (int j = 0; j < 20; ++j) {
+      const int beat = beatDis(gen);
+      const int queryLength = lengthDis(gen);
+      const int clampedBeat =
+          std::max(0, std::min(beat, mNumBeats - 1 - queryLength));
+      int bestDistance = -1;
+      for (int s = 0; s + queryLength <= mNumBeats - 1; ++s) {
+        const int distance = std::abs(s - clampedBeat);
+        if (bruteIsFree(s, s + queryLength) &&
+            (bestDistance < 0 || distance < bestDistance)) {
+          bestDistance = distance;
+        }
+      }
+      const int nearest = mOccupancy.getNearestFreeStart(beat, queryLength);
+      if (bestDistance < 0) {
+        ASSERT_EQ(nearest, -1);
+      } else {
+        ASSERT_TRUE(bruteIsFree(nearest, nearest + queryLength));
+        ASSERT_EQ(std::abs(nearest - clampedBeat), bestDistance)
+            << "beat " << beat << " length " << queryLength;
+      }
+    }
+  }
+}
+
+TEST_F(BeatOccupancyTest, FreeAndClear) {
+  // freeing a range makes it available again, freeing all empties the track
+  const std::pair<int, int> range = mRanges.at(mRanges.size() / 2);
+  EXPECT_FALSE(mOccupancy.isFree(range.first, range.second));
+  mOccupancy.free(range.first, range.second);
+  EXPECT_TRUE(mOccupancy.isFree(range.first, range.second));
+  mOccupancy.clear();
+  EXPECT_TRUE(mOccupancy.isFree(0, mNumBeats - 1));
+  EXPECT_FALSE(mOccupancy.isFree(0, mNumBeats));
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,168 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include <gtest/gtest.h>
+#include <QList>
+#include <QObject>
+
+#include "src/primitive.h"
+#include "src/primitive_list.h"
+
+namespace {
+// Test Fixture Class that creates a list with three motor primitives at beats
+// [0, 4), [10, 14) and [20, 24), and counts the list's change signals
+class PrimitiveListTest : public ::testing::Test {
+ protected:
+  PrimitiveListTest(void) : mList{nullptr} {
+    mList.setNumBeats(100);
+    for (int i = 0; i < 3; ++i) {
+      MotorPrimitive* const mp = new MotorPrimitive();
+      mp->mPositionBeat = 10 * i;
+      mp->mLengthBeat = 4;
+      mList.add(mp);
+      mPrimitives.append(mp);
+    }
+    mList.clearDirtyRange();
+    QObject::connect(&mList, &PrimitiveList::dataChanged,
+                     [this]() { ++mNDataChanged; });
+    QObject::connect(&mList, &PrimitiveList::dirtyRangeChanged,
+                     [this]() { ++mNDirtyRangeChanged; });
+  }
+
+  // check that the primitives are at their initial beats, which are occupied,
+  // and nothing changed
+  void expectUnchanged(void) const {
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(mPrimitives[i]->mPositionBeat, 10 * i);
+      EXPECT_EQ(mPrimitives[i]->mLengthBeat, 4);
+      EXPECT_FALSE(mList.isFree(10 * i, 10 * i + 4));
+      EXPECT_TRUE(mList.isFree(10 * i + 4, 10 * i + 10));
+    }
+    EXPECT_TRUE(mList.isFree(30, 99));
+    int startBeat = 0;
+    int endBeat = 0;
+    EXPECT_FALSE(mList.getDirtyRange(&startBeat, &endBeat));
+    EXPECT_EQ(mNDataChanged, 0);
+    EXPECT_EQ(mNDirtyRangeChanged, 0);
+  }
+
+  PrimitiveList mList;
+  QList<MotorPrimitive*> mPrimitives;
+  int mNDataChanged{0};
+  int mNDirtyRangeChanged{0};
+};
+
+TEST_F(PrimitiveListTest, BatchMove) {
+  SCOPED_TRACE("Valid batch is applied with a single notification");
+  // move the first primitive behind the last, and swap it with the second,
+  // which is only valid as the current ranges of the batch are ignored:
+  mList.beginBatch();
+  mList.setBatchRange(mPrimitives[0], 30, 4);
+  mList.setBatchRange(mPrimitives[0], 10, 4);
+  mList.setBatchRange(mPrimitives[1], 0, 6);
+  EXPECT_TRUE(mList.commitBatch());
+
+  EXPECT_EQ(mPrimitives[0]->mPositionBeat, 10);
+  EXPECT_EQ(mPrimitives[1]->mPositionBeat, 0);
+  EXPECT_EQ(mPrimitives[1]->mLengthBeat, 6);
+  EXPECT_FALSE(mList.isFree(0, 1));
+  EXPECT_FALSE(mList.isFree(5, 6));
+  EXPECT_TRUE(mList.isFree(6, 10));
+  EXPECT_FALSE(mList.isFree(13, 14));
+  EXPECT_TRUE(mList.isFree(14, 20));
+
+  int startBeat = 0;
+  int endBeat = 0;
+  ASSERT_TRUE(mList.getDirtyRange(&startBeat, &endBeat));
+  EXPECT_EQ(startBeat, 0);
+  EXPECT_EQ(endBeat, 14);
+  EXPECT_EQ(mNDataChanged, 1);
+  EXPECT_EQ(mNDirtyRangeChanged, 1);
+
+  // and the sorted data follows the new positions:
+  const QList<QObject*> sorted = mList.getSortedData();
+  ASSERT_EQ(sorted.size(), 3);
+  EXPECT_EQ(sorted[0], mPrimitives[1]);
+  EXPECT_EQ(sorted[1], mPrimitives[0]);
+  EXPECT_EQ(sorted[2], mPrimitives[2]);
+
+  // the batch is done, so committing again does not change anything:
+  EXPECT_TRUE(mList.commitBatch());
+  EXPECT_EQ(mNDataChanged, 1);
+}
+
+TEST_F(PrimitiveListTest, OverlapWithinBatch) {
+  SCOPED_TRACE("Batch overlapping itself is rolled back");
+  mList.beginBatch();
+  mList.setBatchRange(mPrimitives[0], 40, 4);
+  mList.setBatchRange(mPrimitives[1], 43, 4);
+  EXPECT_FALSE(mList.commitBatch());
+  expectUnchanged();
+}
+
+TEST_F(PrimitiveListTest, OverlapWithOthers) {
+  SCOPED_TRACE("Batch overlapping a primitive outside of it is rolled back");
+  mList.beginBatch();
+  mList.setBatchRange(mPrimitives[0], 50, 4);
+  mList.setBatchRange(mPrimitives[1], 22, 4);
+  EXPECT_FALSE(mList.commitBatch());
+  expectUnchanged();
+
+  // and beyond the last beat:
+  mList.beginBatch();
+  mList.setBatchRange(mPrimitives[2], 98, 4);
+  EXPECT_FALSE(mList.commitBatch());
+  expectUnchanged();
+}
+
+TEST_F(PrimitiveListTest, CancelBatch) {
+  SCOPED_TRACE("Cancelled batch is not applied");
+  mList.beginBatch();
+  mList.setBatchRange(mPrimitives[0], 50, 4);
+  mList.cancelBatch();
+  EXPECT_TRUE(mList.commitBatch());
+  expectUnchanged();
+}
+
+TEST_F(PrimitiveListTest, SortedData) {
+  SCOPED_TRACE("Sorted data follows added and moved primitives");
+  MotorPrimitive* const mp = new MotorPrimitive();
+  mp->mPositionBeat = 5;
+  mp->mLengthBeat = 2;
+  mList.add(mp);
+  QList<QObject*> sorted = mList.getSortedData();
+  ASSERT_EQ(sorted.size(), 4);
+  EXPECT_EQ(sorted[1], mp);
+
+  mp->setProperty("positionBeat", 50);
+  sorted = mList.getSortedData();
+  EXPECT_EQ(sorted[3], mp);
+
+  mList.remove(mPrimitives[0]);
+  delete mPrimitives[0];
+  sorted = mList.getSortedData();
+  ASSERT_EQ(sorted.size(), 3);
+  EXPECT_EQ(sorted[0], mPrimitives[1]);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,518 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include <gtest/gtest.h>
+#include <QByteArray>
+#include <QDataStream>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "src/audio_file.h"
+#include "src/command_stream.h"
+#include "src/primitive.h"
+#include "src/primitive_to_signal.h"
+
+namespace {
+// Decode data signal back to commands by measuring the pulse lengths between
+// edges. Pulse length thresholds are in samples for the default bit timing.
+std::vector<CommandStream::Command> decodeSignal(
+    const std::vector<float>& signal);
+
+// Reference renderer for the default bit timing, which evaluates the
+// primitives at every command and carries the signal level from beat to
+// beat, one beat after the other. The signal covers all beats.
+std::vector<float> renderSerial(const std::vector<int>& beatFrames,
+                                const QList<QObject*>& motorPrimitives,
+                                const QList<QObject*>& ledPrimitives);
+
+// Test Fixture Class that creates a song with random beats and primitives
+class PrimitiveToSignalTest : public ::testing::Test {
+ protected:
+  PrimitiveToSignalTest(void) : gen(1234) {
+    // beats between roughly 80 and 170 bpm:
+    std::uniform_int_distribution<int> beatDis(15000, 30000);
+    beatFrames.push_back(0);
+    for (size_t i = 0; i < N_BEATS; ++i) {
+      beatFrames.push_back(beatFrames.back() + beatDis(gen));
+    }
+    audioFile.mFloatData.resize(beatFrames.back(), 0.0f);
+
+    std::uniform_int_distribution<int> lengthDis(1, 8);
+    std::uniform_int_distribution<int> gapDis(0, 2);
+    std::uniform_int_distribution<int> velocityDis(-100, 100);
+    std::uniform_int_distribution<int> frequencyDis(1, 16);
+    const int N_MOTOR_TYPES =
+        static_cast<int>(MotorPrimitive::Type::Custom) + 1;
+    const int N_LED_TYPES = static_cast<int>(LEDPrimitive::Type::Random) + 1;
+
+    for (int pos = 0; pos < N_BEATS - 8;) {
+      MotorPrimitive* mp = new MotorPrimitive();
+      mp->mPositionBeat = pos;
+      mp->mLengthBeat = lengthDis(gen);
+      mp->mType = static_cast<MotorPrimitive::Type>(gen() % N_MOTOR_TYPES);
+      mp->mFrequency = 0.25 * frequencyDis(gen);
+      mp->mVelocity = velocityDis(gen);
+      mp->mVelocityRight = velocityDis(gen);
+      motorPrimitives.append(mp);
+      pos += mp->mLengthBeat + gapDis(gen);
+    }
+
+    for (int pos = 0; pos < N_BEATS - 8;) {
+      LEDPrimitive* lp = new LEDPrimitive();
+      lp->mPositionBeat = pos;
+      lp->mLengthBeat = lengthDis(gen);
+      lp->mType = static_cast<LEDPrimitive::Type>(gen() % N_LED_TYPES);
+      lp->mFrequency = 0.25 * frequencyDis(gen);
+      for (auto&& e : lp->mLeds) {
+        e = gen() % 2;
+      }
+      ledPrimitives.append(lp);
+      pos += lp->mLengthBeat + gapDis(gen);
+    }
+  }
+
+  ~PrimitiveToSignalTest(void) {
+    qDeleteAll(motorPrimitives);
+    qDeleteAll(ledPrimitives);
+  }
+
+  static const int N_BEATS{200};
+  std::mt19937 gen;
+  std::vector<int> beatFrames;
+  AudioFile audioFile;
+  QList<QObject*> motorPrimitives;
+  QList<QObject*> ledPrimitives;
+};
+
+TEST_F(PrimitiveToSignalTest, SignalMatchesCommands) {
+  SCOPED_TRACE("Synthesized signal decodes to command stream");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.convert(motorPrimitives, ledPrimitives);
+
+  const std::vector<CommandStream::Command>& commands =
+      converter.getCommandStream().getCommands();
+  ASSERT_GT(commands.size(), 0u);
+  EXPECT_EQ(decodeSignal(audioFile.mFloatData), commands);
+}
+
+TEST_F(PrimitiveToSignalTest, PartialConversion) {
+  SCOPED_TRACE("Partial conversion matches full conversion");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.convert(motorPrimitives, ledPrimitives);
+
+  for (int i = 0; i < 20; ++i) {
+    // edit a random primitive and only convert its beats:
+    MotorPrimitive* mp = reinterpret_cast<MotorPrimitive*>(
+        motorPrimitives[gen() % motorPrimitives.size()]);
+    mp->mVelocity = static_cast<int>(gen() % 201) - 100;
+    mp->mType = static_cast<MotorPrimitive::Type>(
+        gen() % (static_cast<int>(MotorPrimitive::Type::Custom) + 1));
+    converter.convert(motorPrimitives, ledPrimitives, mp->mPositionBeat,
+                      mp->mPositionBeat + mp->mLengthBeat);
+
+    AudioFile checkFile;
+    checkFile.mFloatData.resize(audioFile.mFloatData.size(), 0.0f);
+    PrimitiveToSignal checkConverter(beatFrames, &checkFile);
+    checkConverter.convert(motorPrimitives, ledPrimitives);
+
+    // the commands are identical, the signal may differ in level and fill
+    // pulses at the end of the partially converted range:
+    EXPECT_EQ(converter.getCommandStream(), checkConverter.getCommandStream());
+    EXPECT_EQ(decodeSignal(audioFile.mFloatData),
+              decodeSignal(checkFile.mFloatData));
+  }
+}
+
+TEST_F(PrimitiveToSignalTest, BlockSynthesis) {
+  SCOPED_TRACE("Block synthesis matches full signal");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.convert(motorPrimitives, ledPrimitives);
+
+  // edit a primitive and only update its commands, such that the blocks are
+  // joined to unchanged beats:
+  MotorPrimitive* mp = reinterpret_cast<MotorPrimitive*>(motorPrimitives[3]);
+  mp->mVelocity = mp->mVelocity == 50 ? 51 : 50;
+  converter.convert(motorPrimitives, ledPrimitives, mp->mPositionBeat,
+                    mp->mPositionBeat + mp->mLengthBeat);
+
+  std::uniform_int_distribution<size_t> startDis(
+      0, audioFile.mFloatData.size() - 1);
+  std::uniform_int_distribution<size_t> lengthDis(1, 10000);
+  std::vector<float> block;
+  for (int i = 0; i < 100; ++i) {
+    const size_t start = startDis(gen);
+    const size_t length =
+        std::min(lengthDis(gen), audioFile.mFloatData.size() - start);
+    block.resize(length);
+    converter.synthesizeFrames(start, length, block.data());
+    EXPECT_TRUE(std::equal(block.begin(), block.end(),
+                           audioFile.mFloatData.begin() + start));
+  }
+
+  // frames beyond the beats are zero:
+  block.assign(100, 1.0f);
+  converter.synthesizeFrames(audioFile.mFloatData.size(), block.size(),
+                             block.data());
+  EXPECT_EQ(block, std::vector<float>(100, 0.0f));
+}
+
+TEST_F(PrimitiveToSignalTest, Reproducible) {
+  SCOPED_TRACE("Random led primitives render reproducibly");
+  for (QObject* const qo : ledPrimitives) {
+    reinterpret_cast<LEDPrimitive*>(qo)->mType = LEDPrimitive::Type::Random;
+  }
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.convert(motorPrimitives, ledPrimitives);
+
+  // converting again, partially or with another converter, yields the same
+  // commands:
+  const CommandStream commands = converter.getCommandStream();
+  converter.convert(motorPrimitives, ledPrimitives, N_BEATS / 2, N_BEATS);
+  EXPECT_EQ(commands, converter.getCommandStream());
+
+  AudioFile checkFile;
+  checkFile.mFloatData.resize(audioFile.mFloatData.size(), 0.0f);
+  PrimitiveToSignal checkConverter(beatFrames, &checkFile);
+  checkConverter.convert(motorPrimitives, ledPrimitives);
+  EXPECT_EQ(commands, checkConverter.getCommandStream());
+  EXPECT_EQ(audioFile.mFloatData, checkFile.mFloatData);
+
+  // and a different seed changes the pattern:
+  LEDPrimitive* const lp = reinterpret_cast<LEDPrimitive*>(ledPrimitives[0]);
+  lp->mSeed += 1;
+  checkConverter.convert(motorPrimitives, ledPrimitives);
+  EXPECT_NE(commands, checkConverter.getCommandStream());
+}
+
+TEST_F(PrimitiveToSignalTest, MatchesSerialReference) {
+  SCOPED_TRACE("Conversion is identical to serial conversion beat by beat");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.convert(motorPrimitives, ledPrimitives);
+  std::vector<float> reference =
+      renderSerial(beatFrames, motorPrimitives, ledPrimitives);
+  EXPECT_EQ(audioFile.mFloatData, reference);
+  EXPECT_EQ(converter.getCommandStream().getCommands(),
+            decodeSignal(reference));
+
+  // converting ranges of unchanged primitives again keeps the signal
+  // identical, whichever level the ranges start at:
+  for (int i = 0; i < 10; ++i) {
+    const size_t startBeat = gen() % N_BEATS;
+    const size_t endBeat = startBeat + gen() % (N_BEATS - startBeat) + 1;
+    converter.convert(motorPrimitives, ledPrimitives, startBeat, endBeat);
+    EXPECT_EQ(audioFile.mFloatData, reference);
+  }
+
+  // after edits, the partially converted commands are the reference ones,
+  // while the signal may differ in level and fill pulses:
+  const int N_MOTOR_TYPES = static_cast<int>(MotorPrimitive::Type::Custom) + 1;
+  const int N_LED_TYPES = static_cast<int>(LEDPrimitive::Type::Random) + 1;
+  for (int i = 0; i < 10; ++i) {
+    MotorPrimitive* mp = reinterpret_cast<MotorPrimitive*>(
+        motorPrimitives[gen() % motorPrimitives.size()]);
+    mp->mType = static_cast<MotorPrimitive::Type>(gen() % N_MOTOR_TYPES);
+    mp->mVelocity = static_cast<int>(gen() % 201) - 100;
+    LEDPrimitive* lp = reinterpret_cast<LEDPrimitive*>(
+        ledPrimitives[gen() % ledPrimitives.size()]);
+    lp->mType = static_cast<LEDPrimitive::Type>(gen() % N_LED_TYPES);
+    converter.convert(motorPrimitives, ledPrimitives, mp->mPositionBeat,
+                      mp->mPositionBeat + mp->mLengthBeat);
+    converter.convert(motorPrimitives, ledPrimitives, lp->mPositionBeat,
+                      lp->mPositionBeat + lp->mLengthBeat);
+
+    reference = renderSerial(beatFrames, motorPrimitives, ledPrimitives);
+    const std::vector<CommandStream::Command> referenceCommands =
+        decodeSignal(reference);
+    EXPECT_EQ(converter.getCommandStream().getCommands(), referenceCommands);
+    EXPECT_EQ(decodeSignal(audioFile.mFloatData), referenceCommands);
+  }
+}
+
+TEST_F(PrimitiveToSignalTest, PrimitivesOutOfRange) {
+  SCOPED_TRACE("Primitives beyond the last beat are clipped");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.convert(motorPrimitives, ledPrimitives);
+  const CommandStream commands = converter.getCommandStream();
+
+  // a straight primitive sticking out of the last beat:
+  MotorPrimitive* mp = new MotorPrimitive();
+  mp->mPositionBeat = N_BEATS - 1;
+  mp->mLengthBeat = 10;
+  mp->mType = MotorPrimitive::Type::Straight;
+  mp->mVelocity = 50;
+  motorPrimitives.append(mp);
+  // and one entirely beyond:
+  mp = new MotorPrimitive();
+  mp->mPositionBeat = N_BEATS + 5;
+  mp->mLengthBeat = 10;
+  motorPrimitives.append(mp);
+
+  converter.convert(motorPrimitives, ledPrimitives, N_BEATS - 1, N_BEATS + 20);
+  EXPECT_NE(commands, converter.getCommandStream());
+  EXPECT_EQ(decodeSignal(audioFile.mFloatData),
+            converter.getCommandStream().getCommands());
+}
+
+TEST_F(PrimitiveToSignalTest, UnsortedPrimitives) {
+  SCOPED_TRACE("Primitives in any order convert like sorted ones");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.generateCommands(motorPrimitives, ledPrimitives, 0, N_BEATS);
+
+  QList<QObject*> shuffledMotorPrimitives = motorPrimitives;
+  QList<QObject*> shuffledLedPrimitives = ledPrimitives;
+  std::shuffle(shuffledMotorPrimitives.begin(), shuffledMotorPrimitives.end(),
+               gen);
+  std::shuffle(shuffledLedPrimitives.begin(), shuffledLedPrimitives.end(),
+               gen);
+  PrimitiveToSignal checkConverter(beatFrames, &audioFile);
+  checkConverter.generateCommands(shuffledMotorPrimitives,
+                                  shuffledLedPrimitives, 0, N_BEATS);
+  EXPECT_EQ(converter.getCommandStream(), checkConverter.getCommandStream());
+}
+
+TEST_F(PrimitiveToSignalTest, Serialization) {
+  SCOPED_TRACE("Command stream serialization");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.generateCommands(motorPrimitives, ledPrimitives, 0, N_BEATS);
+
+  QByteArray dataArray;
+  QDataStream dataStream(&dataArray, QIODevice::ReadWrite);
+  AudioFile::applyDataStreamSettings(&dataStream);
+  converter.getCommandStream().serializeToStream(&dataStream);
+  dataStream.device()->reset();
+
+  CommandStream checkStream(&dataStream);
+  EXPECT_EQ(converter.getCommandStream(), checkStream);
+}
+
+TEST_F(PrimitiveToSignalTest, Difference) {
+  SCOPED_TRACE("Command stream difference");
+  PrimitiveToSignal converter(beatFrames, &audioFile);
+  converter.generateCommands(motorPrimitives, ledPrimitives, 0, N_BEATS);
+  const CommandStream before = converter.getCommandStream();
+
+  quint32 startFrame = 0;
+  quint32 endFrame = 0;
+  EXPECT_FALSE(before.findDifference(before, &startFrame, &endFrame));
+
+  // change a primitive in the middle of the song:
+  MotorPrimitive* mp = reinterpret_cast<MotorPrimitive*>(
+      motorPrimitives[motorPrimitives.size() / 2]);
+  mp->mType = MotorPrimitive::Type::Straight;
+  mp->mVelocity = mp->mVelocity == 50 ? 51 : 50;
+  converter.generateCommands(motorPrimitives, ledPrimitives,
+                             mp->mPositionBeat,
+                             mp->mPositionBeat + mp->mLengthBeat);
+
+  EXPECT_TRUE(before.findDifference(converter.getCommandStream(), &startFrame,
+                                    &endFrame));
+  EXPECT_GE(startFrame, static_cast<quint32>(beatFrames[mp->mPositionBeat]));
+  EXPECT_LE(endFrame, static_cast<quint32>(
+                          beatFrames[mp->mPositionBeat + mp->mLengthBeat]));
+}
+
+std::vector<CommandStream::Command> decodeSignal(
+    const std::vector<float>& signal) {
+  const size_t oneThreshold = 16;
+  const size_t resetThreshold = 32;
+  std::vector<CommandStream::Command> commands;
+  CommandStream::Command command;
+  int nBits = -1;  // negative while waiting for reset pulse
+  quint32 bits = 0;
+  size_t pulseStart = 0;
+  for (size_t i = 1; i < signal.size(); ++i) {
+    if (signal[i] == signal[pulseStart]) {
+      continue;
+    }
+    // edge, process pulse:
+    const size_t pulseLength = i - pulseStart;
+    if (pulseLength >= resetThreshold) {
+      command.frame = static_cast<quint32>(pulseStart);
+      nBits = 0;
+      bits = 0;
+    } else if (nBits >= 0) {
+      if (pulseLength >= oneThreshold) {
+        bits |= (1u << nBits);
+      }
+      if (++nBits == 24) {
+        command.velocityLeft = bits & 0xFF;
+        command.velocityRight = (bits >> 8) & 0xFF;
+        command.leds = (bits >> 16) & 0xFF;
+        commands.push_back(command);
+        nBits = -1;
+      }
+    }
+    pulseStart = i;
+  }
+  return commands;
+}
+
+std::vector<float> renderSerial(const std::vector<int>& beatFrames,
+                                const QList<QObject*>& motorPrimitives,
+                                const QList<QObject*>& ledPrimitives) {
+  const double pi = 3.14159265358979323846;
+  const size_t nZeroSamples = (181 * AudioFile::sampleRate) / 1e6 + 1;
+  const size_t nOneSamples = (3 * 181 * AudioFile::sampleRate) / 1e6 + 1;
+  const size_t nResetSamples = (5 * 181 * AudioFile::sampleRate) / 1e6 + 1;
+  const quint8 knightRiderByte = 0x07;
+  const double knightRiderAmplitude = 2.5;
+  const auto velocityToByte = [](const qint8 velocity) {
+    return static_cast<quint8>(velocity <= 0 ? (-velocity) & 0x7F
+                                             : velocity | 0x80);
+  };
+  const auto randomLed = [](const quint32 seed, const quint32 period) {
+    quint64 x = (static_cast<quint64>(seed) << 32) | period;
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x = x ^ (x >> 31);
+    return static_cast<quint8>(x >> 56);
+  };
+
+  // primitive at every beat:
+  const size_t nBeats = beatFrames.size() - 1;
+  const int nBeatsInt = static_cast<int>(nBeats);
+  std::vector<const MotorPrimitive*> motorPrimitiveMap(nBeats, nullptr);
+  std::vector<const LEDPrimitive*> ledPrimitiveMap(nBeats, nullptr);
+  for (const QObject* const qo : motorPrimitives) {
+    const MotorPrimitive* const mp =
+        reinterpret_cast<const MotorPrimitive*>(qo);
+    for (int i = mp->mPositionBeat;
+         i < mp->mPositionBeat + mp->mLengthBeat && i < nBeatsInt; ++i) {
+      motorPrimitiveMap[i] = mp;
+    }
+  }
+  for (const QObject* const qo : ledPrimitives) {
+    const LEDPrimitive* const lp = reinterpret_cast<const LEDPrimitive*>(qo);
+    for (int i = lp->mPositionBeat;
+         i < lp->mPositionBeat + lp->mLengthBeat && i < nBeatsInt; ++i) {
+      ledPrimitiveMap[i] = lp;
+    }
+  }
+
+  std::vector<float> signal(beatFrames.back(), 0.0f);
+  float level = 0.75f;
+  for (size_t beat = 0; beat < nBeats; ++beat) {
+    const MotorPrimitive* const mp = motorPrimitiveMap[beat];
+    const LEDPrimitive* const lp = ledPrimitiveMap[beat];
+    const size_t startFrame = beatFrames[beat];
+    const size_t endFrame = beatFrames[beat + 1];
+    size_t frame = startFrame;
+    while (true) {
+      const double beatFraction =
+          static_cast<double>(frame - startFrame) / (endFrame - startFrame);
+      qint8 velocityLeft = 0;
+      qint8 velocityRight = 0;
+      quint8 leds = 0;
+      if (mp) {
+        const double relativeBeat = (beat - mp->mPositionBeat) + beatFraction;
+        const double angle = relativeBeat * mp->mFrequency * 2.0 * pi;
+        switch (mp->mType) {
+          case MotorPrimitive::Type::BackAndForth:
+            velocityLeft =
+                static_cast<qint8>(std::round(mp->mVelocity * std::sin(angle)));
+            velocityRight = velocityLeft;
+            break;
+          case MotorPrimitive::Type::Custom:
+            velocityLeft = mp->mVelocity;
+            velocityRight = mp->mVelocityRight;
+            break;
+          case MotorPrimitive::Type::Spin:
+            velocityLeft = -mp->mVelocity;
+            velocityRight = mp->mVelocity;
+            break;
+          case MotorPrimitive::Type::Straight:
+            velocityLeft = mp->mVelocity;
+            velocityRight = mp->mVelocity;
+            break;
+          case MotorPrimitive::Type::Twist:
+            velocityLeft = static_cast<qint8>(
+                -std::round(mp->mVelocity * std::sin(angle)));
+            velocityRight = -velocityLeft;
+            break;
+        }
+      }
+      if (lp) {
+        const double relativeBeat = (beat - lp->mPositionBeat) + beatFraction;
+        const quint32 halfPeriod =
+            static_cast<quint32>(relativeBeat * 2.0 * lp->mFrequency);
+        switch (lp->mType) {
+          case LEDPrimitive::Type::Alternate:
+            leds = halfPeriod % 2 ? ~lp->getLedByte() : lp->getLedByte();
+            break;
+          case LEDPrimitive::Type::Blink:
+            leds = halfPeriod % 2 ? 0 : lp->getLedByte();
+            break;
+          case LEDPrimitive::Type::Constant:
+            leds = lp->getLedByte();
+            break;
+          case LEDPrimitive::Type::KnightRider: {
+            const double angle = lp->mFrequency * relativeBeat * 2.0 * pi;
+            leds = knightRiderByte << static_cast<quint8>(std::round(
+                       knightRiderAmplitude * (1.0 + std::sin(angle))));
+            break;
+          }
+          case LEDPrimitive::Type::Random:
+            leds = randomLed(
+                lp->mSeed,
+                static_cast<quint32>(relativeBeat * lp->mFrequency));
+            break;
+        }
+      }
+
+      const quint32 bits = velocityToByte(velocityLeft) |
+                           (velocityToByte(velocityRight) << 8) |
+                           (static_cast<quint32>(leds) << 16);
+      size_t length = nResetSamples;
+      for (int i = 0; i < 24; ++i) {
+        length += (bits >> i) & 1u ? nOneSamples : nZeroSamples;
+      }
+      if (frame + length >= endFrame) {
+        break;
+      }
+      // reset pulse and bits, toggling the level after each:
+      std::fill(signal.begin() + frame, signal.begin() + frame + nResetSamples,
+                level);
+      frame += nResetSamples;
+      level = -level;
+      for (int i = 0; i < 24; ++i) {
+        const size_t bitLength = (bits >> i) & 1u ? nOneSamples : nZeroSamples;
+        std::fill(signal.begin() + frame, signal.begin() + frame + bitLength,
+                  level);
+        frame += bitLength;
+        level = -level;
+      }
+    }
+    // fill the rest of the beat, without an edge if it is very short:
+    if (endFrame - frame < nZeroSamples / 2) {
+      level = -level;
+    }
+    std::fill(signal.begin() + frame, signal.begin() + endFrame, level);
+    level = -level;
+  }
+  return signal;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
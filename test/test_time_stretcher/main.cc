@@ -0,0 +1,123 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "src/time_stretcher.h"
+
+namespace {
+// Test Fixture Class that provides a stereo sine source, with the right
+// channel phase-shifted and attenuated
+class TimeStretcherTest : public ::testing::Test {
+ protected:
+  TimeStretcherTest(void) : mLeft(mNFrames), mRight(mNFrames) {
+    const double pi = std::acos(-1.0);
+    for (size_t i = 0; i < mNFrames; ++i) {
+      mLeft[i] = 0.5f * std::sin(2.0 * pi * mFreq * i / mSampleRate);
+      mRight[i] =
+          0.25f * std::sin(2.0 * pi * mFreq * i / mSampleRate + 1.0);
+    }
+    mSource = [this](const qint64 startFrame, const size_t nFrames,
+                     float* left, float* right) {
+      for (size_t i = 0; i < nFrames; ++i) {
+        const qint64 frame = startFrame + static_cast<qint64>(i);
+        const bool valid = frame >= 0 && frame < static_cast<qint64>(mNFrames);
+        left[i] = valid ? mLeft[frame] : 0.0f;
+        right[i] = valid ? mRight[frame] : 0.0f;
+      }
+    };
+  }
+
+  // stretch the source from its start to nFrames output frames in blocks
+  void stretch(const double speed, const size_t nFrames,
+               std::vector<float>* left, std::vector<float>* right) {
+    TimeStretcher stretcher;
+    stretcher.reset(mSource, 0, speed);
+    left->resize(nFrames);
+    right->resize(nFrames);
+    size_t done = 0;
+    while (done < nFrames) {
+      const size_t n = std::min(nFrames - done, blockSize);
+      stretcher.process(mSource, n, left->data() + done,
+                        right->data() + done);
+      done += n;
+    }
+    EXPECT_DOUBLE_EQ(stretcher.getPosition(), speed * nFrames);
+  }
+
+  // frequency from number of rising zero crossings
+  double measureFrequency(const std::vector<float>& signal) const {
+    int crossings = 0;
+    for (size_t i = 1; i < signal.size(); ++i) {
+      if (signal[i - 1] < 0.0f && signal[i] >= 0.0f) {
+        ++crossings;
+      }
+    }
+    return crossings * mSampleRate / static_cast<double>(signal.size());
+  }
+
+  const size_t mNFrames{44100 * 4};
+  const size_t blockSize{333};
+  const double mSampleRate{44100.0};
+  const double mFreq{440.0};
+  std::vector<float> mLeft;
+  std::vector<float> mRight;
+  TimeStretcher::Source mSource;
+};
+
+TEST_F(TimeStretcherTest, PitchIsKept) {
+  for (const double speed : {0.5, 0.75, 1.5}) {
+    std::vector<float> left, right;
+    stretch(speed, static_cast<size_t>(mNFrames / speed / 2), &left, &right);
+    EXPECT_NEAR(measureFrequency(left), mFreq, 2.0);
+    EXPECT_NEAR(measureFrequency(right), mFreq, 2.0);
+  }
+}
+
+TEST_F(TimeStretcherTest, AmplitudeIsKept) {
+  std::vector<float> left, right;
+  stretch(0.5, mNFrames, &left, &right);
+  // peak over every period of the left channel, after the start
+  const size_t period = 100;
+  for (size_t i = period; i + period <= left.size(); i += period) {
+    const float peak = std::abs(*std::max_element(
+        left.begin() + i, left.begin() + i + period,
+        [](float a, float b) { return std::abs(a) < std::abs(b); }));
+    EXPECT_NEAR(peak, 0.5f, 0.01f);
+  }
+}
+
+TEST_F(TimeStretcherTest, UnitSpeedReproducesSource) {
+  std::vector<float> left, right;
+  stretch(1.0, mNFrames / 2, &left, &right);
+  for (size_t i = 0; i < left.size(); ++i) {
+    ASSERT_NEAR(left[i], mLeft[i], 1.0e-5f);
+    ASSERT_NEAR(right[i], mRight[i], 1.0e-5f);
+  }
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -23,6 +23,7 @@
 #include <iostream>
 #include <random>
 #include <string>
+#include <vector>
 #include "src/utils.h"
 
 namespace {
@@ -115,6 +116,123 @@ TEST_F(UtilsTest, Search) {
   }
 #endif
 }
+
+TEST_F(UtilsTest, IntervalIndex) {
+  // beat-like intervals with jitter, including values outside the range
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<int> spacing(15000, 30000);
+  std::vector<int> intervals{0};
+  for (size_t i = 1; i < 5000; ++i) {
+    intervals.push_back(intervals.back() + spacing(gen));
+  }
+  utils::IntervalIndex<int> index;
+  index.build(intervals);
+
+  std::uniform_int_distribution<int> uniform(-1000, intervals.back() + 1000);
+  std::vector<int> values(10000);
+  for (auto& v : values) {
+    v = uniform(gen);
+  }
+  // exact interval borders:
+  values.insert(values.end(), intervals.begin(), intervals.end());
+
+  std::vector<int> batchIndices;
+  index.findIntervals(values, &batchIndices);
+  std::vector<int> rangeIndices(values.size() + 1, -2);
+  index.findIntervals(values.data(), values.size(), rangeIndices.data());
+  EXPECT_EQ(rangeIndices.back(), -2);
+  rangeIndices.pop_back();
+  EXPECT_EQ(rangeIndices, batchIndices);
+  for (size_t i = 0; i < values.size(); ++i) {
+    size_t expected = 0;
+    size_t ind = 0;
+    const int expectedRv =
+        utils::findInterval<int>(values[i], intervals, &expected);
+    const int rv = index.findInterval(values[i], &ind);
+    ASSERT_EQ(rv, expectedRv) << "Failed with v = " << values[i];
+    if (rv == 0) {
+      ASSERT_EQ(ind, expected) << "Failed with v = " << values[i];
+      ASSERT_EQ(batchIndices[i], static_cast<int>(expected));
+    } else {
+      ASSERT_EQ(batchIndices[i], -1);
+    }
+  }
+
+  // edge cases of the free function:
+  utils::IntervalIndex<int> edgeIndex;
+  edgeIndex.build(std::vector<int>{0, 10, 20});
+  size_t ind = 0;
+  EXPECT_EQ(edgeIndex.findInterval(-10, &ind), -1);
+  EXPECT_EQ(edgeIndex.findInterval(20, &ind), -1);
+  EXPECT_EQ(edgeIndex.findInterval(19, &ind), 0);
+  EXPECT_EQ(ind, 1u);
+  edgeIndex.build(std::vector<int>{5});
+  EXPECT_EQ(edgeIndex.findInterval(5, &ind), -1);
+}
+
+TEST_F(UtilsTest, IntervalIndexBenchmark) {
+  // compare the lookup index against both search methods on beat-like
+  // intervals of increasing size
+  const std::vector<size_t> arraySizes{100, 1000, 10000};
+  const size_t N_EVALS = 100000;
+  std::mt19937 gen(1);
+  std::uniform_int_distribution<int> spacing(15000, 30000);
+  std::vector<std::string> names{"BINARY", "LINEAR", "INDEX"};
+
+  for (const size_t size : arraySizes) {
+    std::vector<int> intervals{0};
+    for (size_t i = 1; i < size; ++i) {
+      intervals.push_back(intervals.back() + spacing(gen));
+    }
+    utils::IntervalIndex<int> index;
+    index.build(intervals);
+    std::uniform_int_distribution<int> uniform(0, intervals.back() - 1);
+    std::vector<int> values(N_EVALS);
+    for (auto& v : values) {
+      v = uniform(gen);
+    }
+
+    double durationsNs[3] = {0.0, 0.0, 0.0};
+    size_t checkSums[3] = {0, 0, 0};
+    for (int method = 0; method < 3; ++method) {
+      // skip the linear search for large arrays, it takes too long
+      if (method == 1 && size > 1000) {
+        continue;
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      for (const int v : values) {
+        size_t ind = 0;
+        if (method == 2) {
+          index.findInterval(v, &ind);
+        } else {
+          utils::findInterval<int>(v, intervals, &ind,
+                                   static_cast<utils::SearchMethod>(method));
+        }
+        checkSums[method] += ind;
+      }
+      auto end = std::chrono::high_resolution_clock::now();
+      durationsNs[method] =
+          static_cast<double>(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                  .count()) /
+          N_EVALS;
+    }
+    EXPECT_EQ(checkSums[0], checkSums[2]);
+    if (size <= 1000) {
+      EXPECT_EQ(checkSums[0], checkSums[1]);
+    }
+
+    std::cout << "Interval lookup, size " << size << ":";
+    for (int method = 0; method < 3; ++method) {
+      if (durationsNs[method] > 0.0) {
+        std::cout << " " << names[method] << " " << durationsNs[method]
+                  << "nS";
+      }
+    }
+    std::cout << std::endl;
+  }
+}
+
 }  // namespace
 
 int main(int argc, char* argv[]) {
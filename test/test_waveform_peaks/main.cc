@@ -0,0 +1,145 @@
+/*
+ *  Dancebots GUI - Create choreographies for Dancebots
+ *  https://github.com/philippReist/dancebots_gui
+ *
+ *  Copyright 2020 - mint & pepper
+ *
+ *  This program is free software : you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ *  See the GNU General Public License for more details, available in the
+ *  LICENSE file included in the repository.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "src/waveform_peaks.h"
+
+namespace {
+// Test Fixture Class that builds a pyramid of random samples
+class WaveformPeaksTest : public ::testing::Test {
+ protected:
+  WaveformPeaksTest(void) : mSamples(mNFrames) {
+    std::mt19937 gen(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    for (float& sample : mSamples) {
+      sample = dist(gen);
+    }
+    mPeaks.build(&mSamples);
+  }
+
+  // summary of samples [first, last) without SIMD or pyramid
+  WaveformPeaks::Peak bruteForce(size_t first, size_t last) const {
+    last = std::min(last, mSamples.size());
+    WaveformPeaks::Peak peak{mSamples[first], mSamples[first], 0.0f};
+    double sumSquares = 0.0;
+    for (size_t i = first; i < last; ++i) {
+      peak.min = std::min(peak.min, mSamples[i]);
+      peak.max = std::max(peak.max, mSamples[i]);
+      sumSquares += mSamples[i] * mSamples[i];
+    }
+    peak.rms = static_cast<float>(std::sqrt(sumSquares / (last - first)));
+    return peak;
+  }
+
+  const size_t mNFrames{1000003};
+  const size_t mBaseBlockFrames{64};
+  std::vector<float> mSamples;
+  WaveformPeaks mPeaks;
+};
+
+TEST_F(WaveformPeaksTest, Reduce) {
+  for (size_t n = 1; n < 40; ++n) {
+    for (size_t offset = 0; offset < 5; ++offset) {
+      const WaveformPeaks::Peak peak =
+          WaveformPeaks::reduce(mSamples.data() + offset, n);
+      const WaveformPeaks::Peak expected = bruteForce(offset, offset + n);
+      EXPECT_EQ(peak.min, expected.min);
+      EXPECT_EQ(peak.max, expected.max);
+      EXPECT_NEAR(peak.rms, expected.rms, 1.0e-5f);
+    }
+  }
+}
+
+TEST_F(WaveformPeaksTest, SampleColumns) {
+  // columns narrower than a base block are read from the samples
+  const size_t nColumns = 500;
+  std::vector<WaveformPeaks::Peak> columns(nColumns);
+  for (const double framesPerColumn : {0.5, 1.0, 7.3, 63.0}) {
+    const double startFrame = 12345.6;
+    mPeaks.getColumns(startFrame, framesPerColumn, nColumns, columns.data());
+    for (size_t c = 0; c < nColumns; ++c) {
+      const double first = startFrame + c * framesPerColumn;
+      const double last = first + framesPerColumn;
+      const size_t firstFrame = static_cast<size_t>(first);
+      const size_t lastFrame =
+          std::max(firstFrame + 1, static_cast<size_t>(std::ceil(last)));
+      const WaveformPeaks::Peak expected = bruteForce(firstFrame, lastFrame);
+      EXPECT_EQ(columns[c].min, expected.min);
+      EXPECT_EQ(columns[c].max, expected.max);
+    }
+  }
+}
+
+TEST_F(WaveformPeaksTest, PyramidColumns) {
+  // columns cover whole blocks of the level matching the column width
+  const size_t nColumns = 300;
+  std::vector<WaveformPeaks::Peak> columns(nColumns);
+  for (const double framesPerColumn : {64.0, 100.0, 1000.0, 3333.3}) {
+    const double startFrame = 777.7;
+    mPeaks.getColumns(startFrame, framesPerColumn, nColumns, columns.data());
+    const size_t level = static_cast<size_t>(
+        std::log2(framesPerColumn / static_cast<double>(mBaseBlockFrames)));
+    const size_t blockFrames = mBaseBlockFrames << level;
+    for (size_t c = 0; c < nColumns; ++c) {
+      const double first = startFrame + c * framesPerColumn;
+      const double last = std::min(static_cast<double>(mNFrames),
+                                   first + framesPerColumn);
+      if (last <= first) {
+        continue;
+      }
+      const size_t firstFrame =
+          static_cast<size_t>(first) / blockFrames * blockFrames;
+      const size_t lastFrame =
+          static_cast<size_t>(std::ceil(last / blockFrames)) * blockFrames;
+      const WaveformPeaks::Peak expected = bruteForce(firstFrame, lastFrame);
+      EXPECT_EQ(columns[c].min, expected.min);
+      EXPECT_EQ(columns[c].max, expected.max);
+      EXPECT_NEAR(columns[c].rms, expected.rms, 0.01f);
+    }
+  }
+}
+
+TEST_F(WaveformPeaksTest, OutOfRange) {
+  const size_t nColumns = 10;
+  std::vector<WaveformPeaks::Peak> columns(nColumns);
+  for (const double startFrame : {-100000.0, 2.0 * mNFrames}) {
+    mPeaks.getColumns(startFrame, 1000.0, nColumns, columns.data());
+    for (const auto& column : columns) {
+      EXPECT_EQ(column.min, 0.0f);
+      EXPECT_EQ(column.max, 0.0f);
+      EXPECT_EQ(column.rms, 0.0f);
+    }
+  }
+  mPeaks.clear();
+  EXPECT_EQ(mPeaks.getNumFrames(), 0u);
+  mPeaks.getColumns(0.0, 1000.0, nColumns, columns.data());
+  EXPECT_EQ(columns[0].max, 0.0f);
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}